@@ -0,0 +1,160 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/// Collects figures from a possibly multithreaded enumeration into one contiguous array
+/// of fixed-width records, without allocation per figure.
+///
+/// The array is allocated once, from an expected number of figures, and split into blocks
+/// of BlockSize records. Each worker has an arena: a cursor in its own block, taking the next
+/// free block from a shared atomic counter when it is full. Records beyond the capacity go to
+/// per-worker spill vectors. finish() fills the holes left by the last block of each worker,
+/// so all records are contiguous at the beginning of the array.
+/// @tparam Record Fixed-width record with assign(generator), such as FigureRecord.
+template<typename Record>
+struct FigureCollection
+{
+	static constexpr size_t BlockSize = 4096;
+
+	/// Owned by a single worker, no lock is needed.
+	struct Arena
+	{
+		Record* begin = nullptr;
+		Record* cursor = nullptr;
+		Record* end = nullptr;
+		bool bExhausted = false; // No free block left, records go to spill.
+		std::vector<Record> spill;
+	};
+
+	std::unique_ptr<Record[]> records;
+	size_t capacity = 0; // Multiple of BlockSize.
+	size_t size = 0;     // Number of records, valid after finish().
+	size_t spilled = 0;  // Number of records which did not fit in the capacity.
+	std::atomic<size_t> nextBlock{};
+
+	// Filled by reduce(): number of records in the last block of each worker, and spills.
+	std::vector<std::pair<size_t, size_t>> partialBlocks; // (block, used)
+	std::vector<Record> spill;
+
+	/// Capacity in records for an expected number of figures: the last block
+	/// of each worker may be partially used.
+	static size_t capacityFor(uint64_t expectedCount, uint32_t workers)
+	{
+		size_t blocks = (size_t)((expectedCount + BlockSize - 1) / BlockSize) + workers;
+		return blocks * BlockSize;
+	}
+
+	/// Expected number of figures of size n, to be given to init(), from the growth rate of the
+	/// counts of sizes n - 2 and n - 1, which are much cheaper to count. The growth rate slowly
+	/// increases with n, hence the margin.
+	/// @param a Connectivity of chosen pixels, which bounds the count of size 2.
+	/// @param counts Counts of sizes 1 to n - 1, indexed by size - 1.
+	template<typename Counts>
+	static uint64_t expectedCount(uint32_t n, uint32_t a, Counts const& counts)
+	{
+		if (n <= 1)
+			return 1;
+		if (n == 2)
+			return 2 * a;
+		double last = (double)counts[n - 2];
+		return (uint64_t)(1.1 * last * last / (double)counts[n - 3]);
+	}
+
+	/// Memory used by init() with the same parameters, in bytes.
+	static size_t memoryEstimate(uint64_t expectedCount, uint32_t workers)
+	{
+		return capacityFor(expectedCount, workers) * sizeof(Record);
+	}
+
+	/// Allocates the array. Pages are only touched when records are written.
+	void init(uint64_t expectedCount, uint32_t workers)
+	{
+		capacity = capacityFor(expectedCount, workers);
+		records.reset(new Record[capacity]);
+		size = 0;
+		spilled = 0;
+		nextBlock = 0;
+		partialBlocks.clear();
+		spill.clear();
+	}
+
+	/// Appends the current figure of a generator to the arena of the calling worker.
+	template<typename FigGenerator>
+	void add(Arena& arena, FigGenerator const& generator)
+	{
+		if (arena.cursor == arena.end && not arena.bExhausted)
+			nextArenaBlock(arena);
+		if (arena.cursor != arena.end)
+			(arena.cursor++)->assign(generator);
+		else
+			arena.spill.emplace_back().assign(generator);
+	}
+
+	void nextArenaBlock(Arena& arena)
+	{
+		size_t block = nextBlock++;
+		if (block * BlockSize >= capacity) {
+			arena.bExhausted = true;
+			return;
+		}
+		arena.begin = arena.cursor = &records[block * BlockSize];
+		arena.end = arena.begin + BlockSize;
+	}
+
+	/// Called once per arena, after its last record. Calls must be serialized.
+	void reduce(Arena& arena)
+	{
+		if (arena.begin != nullptr)
+			partialBlocks.emplace_back((arena.begin - records.get()) / BlockSize, arena.cursor - arena.begin);
+		spill.insert(spill.end(), arena.spill.begin(), arena.spill.end());
+		arena = {};
+	}
+
+	/// Makes records contiguous, after all arenas are reduced.
+	void finish()
+	{
+		size_t blockCount = capacity / BlockSize;
+		size_t takenBlocks = (nextBlock < blockCount ? (size_t)nextBlock : blockCount);
+		std::vector<size_t> used(takenBlocks, BlockSize);
+		for (auto const& [block, count] : partialBlocks)
+			used[block] = count;
+
+		// Moves records from the last blocks to the holes of the first blocks.
+		size_t lo = 0, hi = takenBlocks;
+		while (true) {
+			while (lo < hi && used[lo] == BlockSize)
+				++lo;
+			while (hi > lo + 1 && used[hi - 1] == 0)
+				--hi;
+			if (lo + 1 >= hi)
+				break;
+			size_t count = BlockSize - used[lo];
+			if (count > used[hi - 1])
+				count = used[hi - 1];
+			used[hi - 1] -= count;
+			memcpy(&records[lo * BlockSize + used[lo]], &records[(hi - 1) * BlockSize + used[hi - 1]], count * sizeof(Record));
+			used[lo] += count;
+		}
+		size = lo * BlockSize + (lo < takenBlocks ? used[lo] : 0);
+
+		// Spilled records need a bigger array, this is the only copy of the whole collection.
+		spilled = spill.size();
+		if (spilled != 0) {
+			capacity = size + spilled;
+			std::unique_ptr<Record[]> bigger(new Record[capacity]);
+			memcpy(bigger.get(), records.get(), size * sizeof(Record));
+			memcpy(bigger.get() + size, spill.data(), spilled * sizeof(Record));
+			records.swap(bigger);
+			size = capacity;
+			spill = {};
+		}
+	}
+
+	Record const* begin() const { return records.get(); }
+	Record const* end() const { return records.get() + size; }
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "FigureRecord.hpp"
+#include "FigureFiles.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+/// Writes figures as columns of fixed-width values, one file per field of FigureRecord,
+/// so that loading them is a sequential read without parsing.
+///
+/// Files are named <prefix>.<field>.col: 'size', 'width' and 'height' have one byte per figure,
+/// 'rows' has Nmax rows of FigureRecord::Row per figure. Each file starts with a header of
+/// HeaderSize bytes, so values are aligned for memory mapping, and the number of figures is
+/// (file size - HeaderSize) / value size. Files are appended: a later run adds figures
+/// to the files of a previous one, if their headers match.
+///
+/// Each worker fills its own buffer, column by column, and flushes it to all files under a lock,
+/// so the k-th value of each file belongs to the same figure.
+/// @tparam Nmax Maximum size of the figures.
+template<uint32_t Nmax>
+struct FigureColumnWriter : FigureFileWriter<4>
+{
+	using Record = FigureRecord<Nmax>;
+	using Row = typename Record::Row;
+
+	static constexpr size_t BufferSize = 4096;
+	static constexpr size_t HeaderSize = 64;
+
+	enum Column : uint32_t { ColSize, ColWidth, ColHeight, ColRows, ColumnCount };
+	static constexpr char const* ColumnNames[ColumnCount] = { "size", "width", "height", "rows" };
+	static constexpr uint32_t ValueSizes[ColumnCount] = { 1, 1, 1, Nmax * sizeof(Row) };
+	static_assert(ColumnCount == 4, "One file per column");
+
+	/// First bytes of the files: magic, then little-endian uint32 of the value size,
+	/// Nmax, and the size of a row in bytes, then the field name. Zero-padded to HeaderSize.
+	struct Header
+	{
+		char magic[8];
+		uint32_t valueSize;
+		uint32_t nmax;
+		uint32_t rowSize;
+		char field[16];
+		uint8_t padding[HeaderSize - 36];
+	};
+	static_assert(sizeof(Header) == HeaderSize);
+
+	uint64_t existingFigures = 0; // In the files before open().
+
+	static std::string columnPath(char const* prefix, uint32_t column)
+	{
+		return std::string(prefix) + "." + ColumnNames[column] + ".col";
+	}
+
+	static Header makeHeader(uint32_t column)
+	{
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "FIGCOL1", 8);
+		header.valueSize = ValueSizes[column];
+		header.nmax = Nmax;
+		header.rowSize = sizeof(Row);
+		strncpy(header.field, ColumnNames[column], sizeof(header.field) - 1);
+		return header;
+	}
+
+	/// Opens the files for appending, writing their header if they are new.
+	/// Fails if existing files have another header or another number of figures.
+	bool open(char const* prefix)
+	{
+		reset();
+		for (uint32_t column = 0; column < ColumnCount; ++column) {
+			std::string path = columnPath(prefix, column);
+			Header expected = makeHeader(column);
+			uint64_t count = 0;
+			bool bExisting = false;
+
+			if (FILE* file = fopen(path.c_str(), "rb")) {
+				Header header;
+				bool bOk = (fread(&header, sizeof(header), 1, file) == 1 && memcmp(&header, &expected, sizeof(header)) == 0);
+				int64_t bytes = (bOk ? fileSize(file) : -1);
+				fclose(file);
+				if (bytes < (int64_t)HeaderSize || (uint64_t)(bytes - HeaderSize) % ValueSizes[column] != 0)
+					return fail();
+				count = (uint64_t)(bytes - HeaderSize) / ValueSizes[column];
+				bExisting = true;
+			}
+			if (column == 0)
+				existingFigures = count;
+			else if (count != existingFigures)
+				return fail();
+
+			if (not openFile(column, path.c_str(), "ab", (bExisting ? nullptr : &expected), sizeof(expected)))
+				return fail();
+		}
+		return true;
+	}
+
+	Buffer makeBuffer() const
+	{
+		return FigureFileWriter::makeBuffer({ BufferSize, BufferSize, BufferSize, BufferSize * ValueSizes[ColRows] });
+	}
+
+	/// Appends the current figure of a generator to the buffer of the calling worker.
+	template<typename FigGenerator>
+	void add(Buffer& buffer, FigGenerator const& generator)
+	{
+		Record record;
+		record.assign(generator);
+		size_t k = buffer.figures++;
+		buffer.data[ColSize][k] = record.size;
+		buffer.data[ColWidth][k] = record.width;
+		buffer.data[ColHeight][k] = record.height;
+		memcpy(&buffer.data[ColRows][k * ValueSizes[ColRows]], record.rows, sizeof(record.rows));
+		for (uint32_t column = 0; column < ColumnCount; ++column)
+			buffer.used[column] += ValueSizes[column];
+		if (buffer.figures == BufferSize)
+			flush(buffer);
+	}
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Freeman chain code of the contour of figures without holes.
+///
+/// The contour follows the edges between chosen and non-chosen pixels, counterclockwise,
+/// from the bottom-left corner of the origin, which is the leftmost pixel of the bottom row.
+/// Codes are 0 for right, 1 for up, 2 for left, 3 for down, one per edge, so the length
+/// is the perimeter, and tracing runs in time proportional to it. As there are no holes,
+/// the contour determines the figure. Where two chosen pixels only touch by a corner,
+/// the contour goes around both of them for a = 8, and between them for a = 4.
+/// For (8,8), non-chosen pixels can also escape by a corner from inside the contour,
+/// so the boundary is not a single curve, and it is not supported.
+/// @tparam Nmax Maximum size of the figures.
+/// @tparam A Connectivity of chosen pixels: 4 or 8.
+/// @tparam B Connectivity of non-chosen pixels: 4 or 8.
+template<uint32_t Nmax, uint32_t A, uint32_t B>
+struct FigureContour
+{
+	static_assert(B == 4 || B == 8, "Figures may have holes");
+	static_assert(not (A == 8 && B == 8), "The boundary of (8,8) figures is not a single curve");
+
+	// Each pixel adds at most 4 edges to the perimeter.
+	static constexpr uint32_t MaxLength = 4 * Nmax;
+
+	/// Writes the codes of the current figure of a FigureGenerator, and returns their number.
+	/// 'codes' must have at least MaxLength bytes.
+	template<typename FigGenerator>
+	static uint32_t trace(FigGenerator const& generator, uint8_t* codes)
+	{
+		using Pos = typename FigGenerator::Pos;
+
+		// Vertex 'pos' is the bottom-left corner of pixel 'pos'. For each direction, the pixels
+		// ahead of a vertex, on the left and on the right of the direction.
+		static constexpr Pos Steps[4] = { FigGenerator::DirRight, FigGenerator::DirUp, FigGenerator::DirLeft, FigGenerator::DirDown };
+		static constexpr Pos AheadLeft[4] = { 0, FigGenerator::DirLeft, FigGenerator::DirDownLeft, FigGenerator::DirDown };
+		static constexpr Pos AheadRight[4] = { FigGenerator::DirDown, 0, FigGenerator::DirLeft, FigGenerator::DirDownLeft };
+
+		auto const& grid = generator.gridChosen;
+		Pos start = FigGenerator::PosOrigin;
+		Pos pos = start;
+		uint32_t dir = 0;
+		uint32_t length = 0;
+		do {
+			codes[length++] = (uint8_t)dir;
+			pos += Steps[dir];
+			// The chosen pixel stays on the left: turn left if there is none ahead,
+			// and right if there are two, or a pixel touching by a corner for a = 8.
+			bool bLeft = grid.get(pos + AheadLeft[dir]);
+			bool bRight = grid.get(pos + AheadRight[dir]);
+			if (bLeft)
+				dir = (bRight ? (dir + 3) & 3 : dir);
+			else
+				dir = (bRight && A == 8 ? (dir + 3) & 3 : (dir + 1) & 3);
+		} while (pos != start);
+		return length;
+	}
+};
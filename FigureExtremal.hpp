@@ -0,0 +1,110 @@
+#pragma once
+
+#include "FigureRecord.hpp"
+#include <vector>
+
+/// Statistics tracked by FigureExtremal, maintained incrementally by
+/// FigureGenerator when its bShape parameter is true.
+enum ExtremalStat : uint32_t
+{
+	StatPerimeter,
+	StatBoundingBoxArea,
+	StatHoles,
+	StatCount,
+};
+
+inline char const* const ExtremalStatNames[StatCount] = { "perimeter", "bbox_area", "holes" };
+
+/// Per level, the minimum and maximum of each ExtremalStat, their multiplicities,
+/// and up to k figures achieving them.
+///
+/// Figures are only encoded when they reach the current extremum, so the cost of
+/// most figures is a few comparisons. Each worker has its own tracker, merged at the end.
+/// @tparam Nmax Maximum size of the figures.
+template<uint32_t Nmax>
+struct FigureExtremal
+{
+	using Record = FigureRecord<Nmax>;
+
+	struct Extremum
+	{
+		int32_t value;
+		uint64_t multiplicity; // Number of figures achieving the value.
+		std::vector<Record> records;
+	};
+
+	uint32_t k = 0;
+	Extremum minima[Nmax][StatCount];
+	Extremum maxima[Nmax][StatCount];
+
+	void init(uint32_t figuresPerExtremum)
+	{
+		k = figuresPerExtremum;
+		for (uint32_t level = 0; level < Nmax; ++level) {
+			for (uint32_t stat = 0; stat < StatCount; ++stat) {
+				minima[level][stat] = { INT32_MAX, 0, {} };
+				maxima[level][stat] = { INT32_MIN, 0, {} };
+			}
+		}
+	}
+
+	/// Offers the current figure of a FigureGenerator having bShape.
+	template<typename FigGenerator>
+	void offer(FigGenerator const& generator)
+	{
+		uint32_t level = generator.level;
+		int32_t values[StatCount];
+		values[StatPerimeter] = generator.shapes.shape[level].perimeter;
+		values[StatBoundingBoxArea] = generator.boundingBoxArea();
+		values[StatHoles] = generator.holes();
+
+		for (uint32_t stat = 0; stat < StatCount; ++stat) {
+			Extremum& min = minima[level][stat];
+			if (values[stat] <= min.value)
+				update(min, values[stat] < min.value, values[stat], generator);
+			Extremum& max = maxima[level][stat];
+			if (values[stat] >= max.value)
+				update(max, values[stat] > max.value, values[stat], generator);
+		}
+	}
+
+	template<typename FigGenerator>
+	void update(Extremum& extremum, bool bBetter, int32_t value, FigGenerator const& generator)
+	{
+		if (bBetter) {
+			extremum.value = value;
+			extremum.multiplicity = 0;
+			extremum.records.clear();
+		}
+		++extremum.multiplicity;
+		if (extremum.records.size() < k)
+			extremum.records.emplace_back().assign(generator);
+	}
+
+	/// Merges the extrema of another tracker, whose figures are disjoint from ours.
+	void merge(FigureExtremal const& other)
+	{
+		for (uint32_t level = 0; level < Nmax; ++level) {
+			for (uint32_t stat = 0; stat < StatCount; ++stat) {
+				merge(minima[level][stat], other.minima[level][stat], -1);
+				merge(maxima[level][stat], other.maxima[level][stat], +1);
+			}
+		}
+	}
+
+	/// @param sign +1 to keep the maximum, -1 to keep the minimum.
+	void merge(Extremum& mine, Extremum const& theirs, int32_t sign)
+	{
+		if (theirs.multiplicity == 0)
+			return;
+		if (mine.multiplicity == 0 || sign * theirs.value > sign * mine.value) {
+			mine = theirs;
+		}
+		else if (theirs.value == mine.value) {
+			mine.multiplicity += theirs.multiplicity;
+			for (Record const& record : theirs.records)
+				if (mine.records.size() < k)
+					mine.records.push_back(record);
+		}
+	}
+};
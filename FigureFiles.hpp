@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+
+/// Size of an open file in bytes, -1 on error. The position is back to the start.
+/// Offsets are 64-bit on all platforms, as 'long' is 32-bit with MSVC.
+inline int64_t fileSize(FILE* file)
+{
+#ifdef _MSC_VER
+	int64_t bytes = (_fseeki64(file, 0, SEEK_END) == 0 ? _ftelli64(file) : -1);
+	return (_fseeki64(file, 0, SEEK_SET) == 0 ? bytes : -1);
+#else
+	int64_t bytes = (fseeko(file, 0, SEEK_END) == 0 ? (int64_t)ftello(file) : -1);
+	return (fseeko(file, 0, SEEK_SET) == 0 ? bytes : -1);
+#endif
+}
+
+/// Moves the position of an open file to a 64-bit offset from the start. Returns false on error.
+inline bool seekFile(FILE* file, int64_t offset)
+{
+#ifdef _MSC_VER
+	return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+}
+
+/// Files written by the workers of an enumeration, each worker encoding figures into its own
+/// buffer, which is written under a lock when full, so the files receive large writes of whole
+/// figures. After a failed write, the following ones are skipped and close() returns false.
+/// Writers of a format derive from it, and only encode figures.
+/// @tparam FileCount Number of files, a buffer has bytes for each of them.
+template<uint32_t FileCount>
+struct FigureFileWriter
+{
+	/// Owned by a single worker, no lock is needed.
+	struct Buffer
+	{
+		std::vector<uint8_t> data[FileCount];
+		size_t used[FileCount] = {}; // Bytes of data to be written.
+		uint64_t figures = 0;
+	};
+
+	FILE* files[FileCount] = {};
+	uint64_t figures = 0; // Written since reset().
+	uint64_t bytes = 0;
+	bool bError = false;
+	std::mutex mutex;
+
+	~FigureFileWriter()
+	{
+		close();
+	}
+
+	/// Closes the files of a previous run, and clears the error and the counters.
+	void reset()
+	{
+		close();
+		bError = false;
+		figures = 0;
+		bytes = 0;
+	}
+
+	/// Opens one of the files, then writes its header if any.
+	bool openFile(uint32_t k, char const* path, char const* mode, void const* header = nullptr, size_t headerSize = 0)
+	{
+		files[k] = fopen(path, mode);
+		bError |= (files[k] == nullptr || (header != nullptr && fwrite(header, headerSize, 1, files[k]) != 1));
+		return not bError;
+	}
+
+	Buffer makeBuffer(size_t const (&capacities)[FileCount]) const
+	{
+		Buffer buffer;
+		for (uint32_t k = 0; k < FileCount; ++k)
+			buffer.data[k].resize(capacities[k]);
+		return buffer;
+	}
+
+	/// Writes the buffer of a worker at the position of the files, or at 'offset' if not negative.
+	/// Called when the buffer is full, and once per worker after its last figure.
+	void flush(Buffer& buffer, int64_t offset = -1)
+	{
+		uint64_t count = buffer.figures;
+		size_t used[FileCount];
+		for (uint32_t k = 0; k < FileCount; ++k) {
+			used[k] = buffer.used[k];
+			buffer.used[k] = 0;
+		}
+		buffer.figures = 0;
+		if (count == 0)
+			return;
+		std::lock_guard lock(mutex);
+		if (bError)
+			return;
+		for (uint32_t k = 0; k < FileCount; ++k) {
+			if (offset >= 0)
+				bError |= not seekFile(files[k], offset);
+			bError = bError || (fwrite(buffer.data[k].data(), 1, used[k], files[k]) != used[k]);
+			bytes += used[k];
+		}
+		figures += count;
+	}
+
+	/// Closes the files. Returns false if any write failed.
+	bool close()
+	{
+		for (FILE*& file : files) {
+			if (file != nullptr) {
+				bError |= (fclose(file) != 0);
+				file = nullptr;
+			}
+		}
+		return not bError;
+	}
+
+	bool fail()
+	{
+		close();
+		bError = true;
+		return false;
+	}
+};
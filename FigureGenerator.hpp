@@ -3,6 +3,12 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <limits.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 // Helper to disable state storage when not needed.
 template<bool Condition, typename T>
@@ -11,22 +17,61 @@ struct StoreIf : T {};
 template<typename T>
 struct StoreIf<false, T> {};
 
+inline uint32_t countTrailingZeros(uint64_t x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return index;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
 struct FigureGeneratorStats {
 	uint64_t nonLeaf;  // Number of figures with children.
 	uint64_t leaf;     // Number of figures without children.
 	uint64_t rejected; // Number of rejections by the validity check.
+	uint64_t lookupMiss; // Number of checks not concluded by the neighbourhood, for connectivity (8,8).
+	uint64_t slowPath;   // Number of graph traversals, for connectivity (8,8).
+	uint64_t visitedCells; // Number of pixels visited by graph traversals, for connectivity (8,8).
+
+	// Per neighbourhood pattern (see FigureGenerator::getNeighbourhood()),
+	// results of the validity check and number of graph traversals.
+	uint64_t patternAccepted[256];
+	uint64_t patternRejected[256];
+	uint64_t patternSlowPath[256];
+
+	void merge(FigureGeneratorStats const& other)
+	{
+		nonLeaf += other.nonLeaf;
+		leaf += other.leaf;
+		rejected += other.rejected;
+		lookupMiss += other.lookupMiss;
+		slowPath += other.slowPath;
+		visitedCells += other.visitedCells;
+		for (uint32_t n = 0; n < 256; ++n) {
+			patternAccepted[n] += other.patternAccepted[n];
+			patternRejected[n] += other.patternRejected[n];
+			patternSlowPath[n] += other.patternSlowPath[n];
+		}
+	}
 };
 
 /// @tparam Nmax Maximum size of generated figures
 /// @tparam A Connectivity of chosen pixels: 4 or 8.
 /// @tparam B Connectivity of non-chosen pixels: 4, 8 or 0 to disable check.
 /// @tparam bStats Whether to measure some statistics, with worse performances.
-template<uint32_t Nmax, uint32_t A, uint32_t B, bool bStats = false>
+/// @tparam bShape Whether to maintain the shape of the figure, with worse performances.
+template<uint32_t Nmax, uint32_t A, uint32_t B, bool bStats = false, bool bShape = false>
 struct FigureGenerator
 {
 	static_assert(A == 4 || A == 8);
 	static_assert(B == 0 || B == 4 || B == 8);
 
+	// Chosen pixels are needed by the white connectivity check and by the shape.
+	static constexpr bool HasGridChosen = (B != 0 || bShape);
+
 	// ============================================================
 	// Constants definitions related to the grid where figures will be generated.
 	// Width and Height have margins such that we do not require bound-checking.
@@ -39,6 +84,7 @@ struct FigureGenerator
 	using Pos = int16_t;
 
 	static constexpr Pos PosOrigin = (Width / 2) + 2 * Width;
+	static constexpr int32_t OriginRow = PosOrigin / Width;
 
 	// ============================================================
 	// Directions are defined as position offsets.
@@ -65,7 +111,7 @@ struct FigureGenerator
 		static constexpr uint32_t U64size = (GridSize + 63) / 64;
 		uint64_t u64[U64size] {};
 
-		constexpr bool get(Pos pos)
+		constexpr bool get(Pos pos) const
 		{
 			return (u64[pos / 64] >> (pos % 64)) & 1;
 		}
@@ -79,6 +125,15 @@ struct FigureGenerator
 		{
 			u64[pos / 64] &= ~((uint64_t)1 << (pos % 64));
 		}
+
+		/// Copies the grid of a generator only differing by bStats, of the same size.
+		template<typename OtherGrid>
+		constexpr void assign(OtherGrid const& other)
+		{
+			static_assert(sizeof(other.u64) == sizeof(u64));
+			for (uint32_t k = 0; k < U64size; ++k)
+				u64[k] = other.u64[k];
+		}
 	};
 
 	// ============================================================
@@ -92,8 +147,8 @@ struct FigureGenerator
 
 	BitGrid gridCandidates;
 
-	// Only needed for white connectivity check.
-	StoreIf<B != 0, BitGrid> gridChosen;
+	// Only needed for white connectivity check and shape.
+	StoreIf<HasGridChosen, BitGrid> gridChosen;
 
 	// ============================================================
 	// Validity check state.
@@ -114,6 +169,24 @@ struct FigureGenerator
 
 	StoreIf<bStats, FigureGeneratorStats> stats;
 
+	// ============================================================
+	// Shape of the figure at each level, maintained if bShape is true.
+
+	struct Shape
+	{
+		uint16_t perimeter; // Number of edges between chosen and non-chosen pixels.
+		int16_t xmin;       // Bounding box, in grid coordinates.
+		int16_t xmax;       // The bottom row is always OriginRow.
+		int16_t ymax;
+		int16_t euler;      // Number of components minus number of holes.
+	};
+	struct Shapes { Shape shape[Nmax]; };
+	StoreIf<bShape, Shapes> shapes;
+
+	// Variation of the Euler number when choosing a pixel, given its neighbourhood.
+	struct EulerLookup { int8_t table[256]; };
+	StoreIf<bShape, EulerLookup> eulerLookup;
+
 	// ============================================================
 	// Algorithm core.
 
@@ -127,11 +200,40 @@ struct FigureGenerator
 		for (Pos pos = 0; pos <= PosOrigin; ++pos)
 			gridCandidates.set(pos);
 		chosenIndices[0] = 0;
-		if constexpr (B != 0)
+		if constexpr (HasGridChosen)
 			gridChosen.set(PosOrigin);
+		if constexpr (bShape) {
+			constexpr int16_t x = PosOrigin % Width;
+			shapes.shape[0] = { 4, x, x, OriginRow, 1 };
+			initLookupTableEuler();
+		}
 		level = 0;
 	}
 
+	/// Copies the state of a generator only differing by bStats, so that statistics
+	/// can be measured on some subtrees only. Statistics start from zero.
+	template<bool bOtherStats>
+	void assignState(FigureGenerator<Nmax, A, B, bOtherStats, bShape> const& other)
+	{
+		// Apart from statistics, both generators have the same layout.
+		auto funcCopy = [] (auto& dst, auto const& src) {
+			static_assert(sizeof(dst) == sizeof(src));
+			memcpy(&dst, &src, sizeof(dst));
+		};
+		count = other.count;
+		level = other.level;
+		funcCopy(candidateCounts, other.candidateCounts);
+		funcCopy(chosenIndices, other.chosenIndices);
+		funcCopy(candidates, other.candidates);
+		gridCandidates.assign(other.gridCandidates);
+		if constexpr (HasGridChosen)
+			gridChosen.assign(other.gridChosen);
+		funcCopy(validityLookup, other.validityLookup);
+		funcCopy(shapes, other.shapes);
+		funcCopy(eulerLookup, other.eulerLookup);
+		stats = {};
+	}
+
 	/// @param callbackNewFigure Called once per figure.
 	/// @param nmax Maximum size to iterate.
 	template <typename Func>
@@ -164,17 +266,19 @@ struct FigureGenerator
 
 	/// Rewording of the generate() function, but a single invocation
 	/// corresponds to the code executed between two valid figures.
+	/// @param nmax Maximum size to iterate.
+	/// @param rootLevel Only iterate descendants of the figure at this level.
 	/// @retval true if current figure is valid and iteration can continue.
 	/// @retval false if we have reached end of iteration.
-	bool nextStep(uint32_t nmax = Nmax)
+	bool nextStep(uint32_t nmax = Nmax, uint32_t rootLevel = 0)
 	{
 		if (level < nmax - 1)
 			if (firstChild())
 				if (checkValidity())
 					return true;
 		do {
-			while (not nextSibling()) {
-				if (level == 0)
+			while (level == rootLevel || not nextSibling()) {
+				if (level == rootLevel)
 					return false;
 				parent();
 			}
@@ -185,10 +289,28 @@ struct FigureGenerator
 	bool firstChild()
 	{
 		uint32_t idx = chosenIndices[level];
-		Pos pos = candidates[idx];
+		addCandidates(candidates[idx]);
+		if (idx + 1 == count) {
+			if constexpr (bStats)
+				++stats.nonLeaf;
+			return false;
+		}
 
-		// Add neighbours of 'pos' as candidates.
+		++level;
+		candidateCounts[level] = count;
+		chosenIndices[level] = idx + 1;
+		if constexpr (HasGridChosen)
+			gridChosen.set(candidates[idx + 1]);
+		if constexpr (bShape)
+			updateShape();
+		if constexpr (bStats)
+			++stats.leaf;
+		return true;
+	}
 
+	/// Adds neighbours of 'pos' as candidates.
+	void addCandidates(Pos pos)
+	{
 		auto funcAddCandidate = [this] (Pos pos) {
 			if (not gridCandidates.get(pos)) {
 				gridCandidates.set(pos);
@@ -213,31 +335,19 @@ struct FigureGenerator
 			funcAddCandidate(pos + DirDown);
 			funcAddCandidate(pos + DirDownRight);
 		}
-		if (idx + 1 == count) {
-			if constexpr (bStats)
-				++stats.nonLeaf;
-			return false;
-		}
-
-		++level;
-		candidateCounts[level] = count;
-		chosenIndices[level] = idx + 1;
-		if constexpr (B != 0)
-			gridChosen.set(candidates[idx + 1]);
-		if constexpr (bStats)
-			++stats.leaf;
-		return true;
 	}
 
 	bool nextSibling()
 	{
 		uint32_t idx = chosenIndices[level];
 		if (idx + 1 < count) {
-			if constexpr (B != 0) {
+			if constexpr (HasGridChosen) {
 				gridChosen.reset(candidates[idx]);
 				gridChosen.set(candidates[idx + 1]);
 			}
 			chosenIndices[level] = idx + 1;
+			if constexpr (bShape)
+				updateShape();
 			return true;
 		}
 		else {
@@ -247,7 +357,7 @@ struct FigureGenerator
 
 	void parent()
 	{
-		if constexpr (B != 0)
+		if constexpr (HasGridChosen)
 			gridChosen.reset(candidates[chosenIndices[level]]);
 		--level;
 		for (uint32_t idx = candidateCounts[level]; idx < count; ++idx)
@@ -255,28 +365,166 @@ struct FigureGenerator
 		count = candidateCounts[level];
 	}
 
+	// ============================================================
+	// Shape maintenance.
+
+	/// Computes the shape of current level from the shape of the previous level.
+	void updateShape()
+	{
+		Pos pos = candidates[chosenIndices[level]];
+		Shape const& prev = shapes.shape[level - 1];
+		Shape& shape = shapes.shape[level];
+		uint8_t neighbourhood = getNeighbourhood(pos);
+
+		// Each chosen 4-neighbour (b, d, f, h) hides one edge of the new pixel and one of its own.
+		uint32_t adjacent = ((neighbourhood >> 1) & 1) + ((neighbourhood >> 3) & 1)
+		                  + ((neighbourhood >> 4) & 1) + ((neighbourhood >> 6) & 1);
+		shape.perimeter = prev.perimeter + 4 - 2 * adjacent;
+		shape.euler = prev.euler + eulerLookup.table[neighbourhood];
+
+		int16_t x = pos % Width, y = pos / Width;
+		shape.xmin = (x < prev.xmin ? x : prev.xmin);
+		shape.xmax = (x > prev.xmax ? x : prev.xmax);
+		shape.ymax = (y > prev.ymax ? y : prev.ymax);
+	}
+
+	/// Number of holes, i.e. bounded components of non-chosen pixels,
+	/// which are 8-connected if A == 4, and 4-connected if A == 8.
+	uint32_t holes() const
+	{
+		return 1 - shapes.shape[level].euler;
+	}
+
+	/// Area of the bounding box.
+	uint32_t boundingBoxArea() const
+	{
+		Shape const& shape = shapes.shape[level];
+		return (shape.xmax - shape.xmin + 1) * (shape.ymax - OriginRow + 1);
+	}
+
+	void initLookupTableEuler()
+	{
+		// Gray's bit-quads: with Q1, Q3 and QD the number of 2x2 windows having one chosen pixel,
+		// three chosen pixels, or two diagonal chosen pixels, the Euler number is
+		// (Q1 - Q3 + 2 QD) / 4 for 4-connectivity, and (Q1 - Q3 - 2 QD) / 4 for 8-connectivity.
+		// Choosing a pixel only modifies the four windows containing it.
+		auto funcWindow = [] (bool topLeft, bool topRight, bool bottomLeft, bool bottomRight) {
+			int count = topLeft + topRight + bottomLeft + bottomRight;
+			bool diagonal = (count == 2) && (topLeft == bottomRight);
+			return (count == 1) - (count == 3) + (diagonal ? (A == 4 ? 2 : -2) : 0);
+		};
+		for (uint32_t n = 0; n < 256; ++n) {
+			// a b c
+			// d   f
+			// g h i
+			bool a = (n & 1), b = (n & 2), c = (n & 4), d = (n & 8),
+				 f = (n & 16), g = (n & 32), h = (n & 64), i = (n & 128);
+			int delta = funcWindow(a, b, d, true) - funcWindow(a, b, d, false)
+			          + funcWindow(b, c, true, f) - funcWindow(b, c, false, f)
+			          + funcWindow(d, true, g, h) - funcWindow(d, false, g, h)
+			          + funcWindow(true, f, h, i) - funcWindow(false, f, h, i);
+			eulerLookup.table[n] = delta / 4;
+		}
+	}
+
+	/// Smallest perimeter of a figure with 'area' pixels: 2 * ceil(2 * sqrt(area)).
+	static constexpr uint32_t minPerimeter(uint32_t area)
+	{
+		uint32_t halfPerimeter = 2;
+		while ((halfPerimeter / 2) * ((halfPerimeter + 1) / 2) < area)
+			++halfPerimeter;
+		return 2 * halfPerimeter;
+	}
+
+	/// Biggest area of a figure whose perimeter is 'perimeter' or less.
+	static constexpr uint32_t maxArea(uint32_t perimeter)
+	{
+		uint32_t halfPerimeter = perimeter / 2;
+		return (halfPerimeter / 2) * ((halfPerimeter + 1) / 2);
+	}
+
+	/// Lower bound of the perimeter of the current figure and all its descendants.
+	/// Adding pixels never shrinks the bounding box, and each of its rows and columns
+	/// contributes at least two edges to the perimeter.
+	uint32_t perimeterLowerBound() const
+	{
+		Shape const& shape = shapes.shape[level];
+		return 2 * ((shape.xmax - shape.xmin + 1) + (shape.ymax - OriginRow + 1));
+	}
+
+	/// Variant of generate() iterating over figures of perimeter <= pmax, instead of size <= nmax.
+	/// Subtrees are pruned when a lower bound on the perimeter of all descendants exceeds pmax.
+	/// Nmax must be at least maxArea(pmax), else bigger figures are missing.
+	/// @param callbackNewFigure Called once per figure whose perimeter is <= pmax.
+	/// @param pmax Maximum perimeter to iterate.
+	template <typename Func>
+	void generateBoundedPerimeter(Func&& callbackNewFigure, uint32_t pmax)
+	{
+		static_assert(bShape, "The perimeter is only maintained with bShape");
+
+		// Children of a figure at 'level' have at least 'level + 2' pixels.
+		uint32_t childMinPerimeter[Nmax];
+		for (uint32_t k = 0; k < Nmax; ++k)
+			childMinPerimeter[k] = minPerimeter(k + 2);
+
+		while (true) {
+			while (checkValidity()) {
+				if (shapes.shape[level].perimeter <= pmax)
+					callbackNewFigure();
+				// Pruning: no descendant can have a small enough perimeter.
+				if (level >= Nmax - 1 || perimeterLowerBound() > pmax || childMinPerimeter[level] > pmax) {
+					if constexpr (bStats)
+						++stats.nonLeaf;
+					break;
+				}
+				else if (not firstChild()) {
+					break;
+				}
+			}
+			while (not nextSibling()) {
+				if (level == 0)
+					return;
+				parent();
+			}
+		}
+	}
+
 	// ============================================================
 	// Validity check.
 
+	/// Chosen pixels around 'pos', as a bitmask:
+	/// a b c
+	/// d   f   -> (a << 0) | (b << 1) | ... | (i << 7)
+	/// g h i
+	uint8_t getNeighbourhood(Pos pos)
+	{
+		bool a = gridChosen.get(pos + DirUpLeft);
+		bool b = gridChosen.get(pos + DirUp);
+		bool c = gridChosen.get(pos + DirUpRight);
+		bool d = gridChosen.get(pos + DirLeft);
+		bool f = gridChosen.get(pos + DirRight);
+		bool g = gridChosen.get(pos + DirDownLeft);
+		bool h = gridChosen.get(pos + DirDown);
+		bool i = gridChosen.get(pos + DirDownRight);
+		return (a << 0) | (b << 1) | (c << 2) | (d << 3)
+		     | (f << 4) | (g << 5) | (h << 6) | (i << 7);
+	}
+
 	bool checkValidity()
+	{
+		return checkValidityAt(candidates[chosenIndices[level]]);
+	}
+
+	/// Whether the figure is valid, 'pos' being its last chosen pixel.
+	/// 'pos' must be chosen in gridChosen.
+	bool checkValidityAt(Pos pos)
 	{
 		bool bResult = false;
 		if constexpr (B == 0) {
 			bResult = true;
 		}
 		else {
-			// Get neighbourhood.
-			Pos pos = candidates[chosenIndices[level]];
-			bool a = gridChosen.get(pos + DirUpLeft);
-			bool b = gridChosen.get(pos + DirUp);
-			bool c = gridChosen.get(pos + DirUpRight);
-			bool d = gridChosen.get(pos + DirLeft);
-			bool f = gridChosen.get(pos + DirRight);
-			bool g = gridChosen.get(pos + DirDownLeft);
-			bool h = gridChosen.get(pos + DirDown);
-			bool i = gridChosen.get(pos + DirDownRight);
-			uint8_t neighbourhood = (a << 0) | (b << 1) | (c << 2) | (d << 3)
-			                      | (f << 4) | (g << 5) | (h << 6) | (i << 7);
+			uint8_t neighbourhood = getNeighbourhood(pos);
 
 			if constexpr (A != 8 || B != 8) {
 				bResult = validityLookup.table[neighbourhood];
@@ -287,60 +535,207 @@ struct FigureGenerator
 				}
 				else {
 					// For (8,8), we cannot reject for sure with the neighbourhood.
-					// We need to do a proper graph traversal among the white pixels.
-
-					// White neighbours are candidates, except chosen pixels.
-					for (uint32_t k = 0; k < BitGrid::U64size; ++k)
-						visit.grid.u64[k] = gridCandidates.u64[k] & ~gridChosen.u64[k];
-
-					// In gridCandidates, we also have all pos before PosOrigin.
-					// Among them, all pos before (PosOrigin + DirDownLeft) are
-					//_not necessary to visit.
-					constexpr Pos FirstVisitPos = (PosOrigin + DirDownLeft);
-					for (uint32_t k = 0; k < FirstVisitPos / 64; ++k)
-						visit.grid.u64[k] = 0;
-					for (Pos p = ((FirstVisitPos / 64) * 64); p <= FirstVisitPos; ++p)
-						visit.grid.reset(p);
-
-					visit.count = 1;
-					visit.queue[0] = FirstVisitPos;
-
-					auto funcVisit = [this](Pos pos) {
-						if (visit.grid.get(pos)) {
-							visit.grid.reset(pos);
-							visit.queue[visit.count] = pos;
-							++visit.count;
-						}
-						};
-
-					while (visit.count > 0) {
-						--visit.count;
-						Pos p = visit.queue[visit.count];
-						funcVisit(p + DirRight);
-						funcVisit(p + DirUpRight);
-						funcVisit(p + DirUp);
-						funcVisit(p + DirUpLeft);
-						funcVisit(p + DirLeft);
-						funcVisit(p + DirDownLeft);
-						funcVisit(p + DirDown);
-						funcVisit(p + DirDownRight);
-					}
-					// If there is any gridVisit pixel not visited, reject.
-					bResult = true;
-					for (uint32_t k = 0; k < BitGrid::U64size; ++k) {
-						if (visit.grid.u64[k]) {
-							bResult = false;
-							break;
-						}
-					}
+					bResult = checkValidityExtended(pos, neighbourhood);
 				}
 			}
+			// The lone root pixel is only checked by generate(), not by nextStep() nor the other
+			// engines: it is left out, so that all engines count the same patterns.
+			if constexpr (bStats)
+				if (level != 0)
+					++(bResult ? stats.patternAccepted : stats.patternRejected)[neighbourhood];
 		}
 		if constexpr (bStats)
 			stats.rejected += !bResult;
 		return bResult;
 	}
 
+	/// Only used for connectivity (8,8), when the neighbourhood of 'pos' is not enough to conclude:
+	/// looks at the 5x5 window around 'pos', and only does the graph traversal if still needed.
+	/// 'pos' must be chosen in gridChosen.
+	bool checkValidityExtended(Pos pos, uint8_t neighbourhood)
+	{
+		if constexpr (bStats)
+			++stats.lookupMiss;
+		switch (ExtendedLookup::get().find(neighbourhood, getOuterNeighbourhood(pos))) {
+			case ExtendedLookup::Valid: return true;
+			case ExtendedLookup::Invalid: return false;
+			default: break;
+		}
+		if constexpr (bStats)
+			++stats.patternSlowPath[neighbourhood];
+		return checkValidityGlobal();
+	}
+
+	/// Chosen pixels around the neighbourhood of 'pos', as a bitmask:
+	/// 0  1  2  3  4
+	/// 5  a  b  c  6
+	/// 7  d     f  8
+	/// 9  g  h  i  10
+	/// 11 12 13 14 15
+	uint16_t getOuterNeighbourhood(Pos pos)
+	{
+		constexpr Pos Offsets[16] = {
+			2 * DirUp + 2 * DirLeft, 2 * DirUp + DirLeft, 2 * DirUp, 2 * DirUp + DirRight, 2 * DirUp + 2 * DirRight,
+			DirUp + 2 * DirLeft, DirUp + 2 * DirRight,
+			2 * DirLeft, 2 * DirRight,
+			DirDown + 2 * DirLeft, DirDown + 2 * DirRight,
+			2 * DirDown + 2 * DirLeft, 2 * DirDown + DirLeft, 2 * DirDown, 2 * DirDown + DirRight, 2 * DirDown + 2 * DirRight,
+		};
+		uint16_t outer = 0;
+		for (uint32_t k = 0; k < 16; ++k)
+			outer |= gridChosen.get(pos + Offsets[k]) << k;
+		return outer;
+	}
+
+	/// Only used for connectivity (8,8): second stage of the validity lookup, for the
+	/// neighbourhoods rejected by validityLookup, keyed by the 16 pixels around them.
+	/// In the 5x5 window, either the white pixels around the new pixel are connected (valid),
+	/// or one of their components is enclosed by black pixels (a hole, invalid),
+	/// or their components are only connected through the outside (unknown).
+	/// The table is built once and shared by all generators, as it weighs about 2 MB.
+	struct ExtendedLookup
+	{
+		enum Result : uint8_t { Unknown, Valid, Invalid };
+
+		uint8_t innerIndices[256];   // Index of the neighbourhood in 'results', if rejected by validityLookup.
+		std::vector<uint8_t> results; // 2 bits per entry, 65536 entries per rejected neighbourhood.
+
+		Result find(uint8_t neighbourhood, uint16_t outer) const
+		{
+			uint32_t idx = ((uint32_t)innerIndices[neighbourhood] << 16) | outer;
+			return (Result)((results[idx / 4] >> (2 * (idx % 4))) & 3);
+		}
+
+		static ExtendedLookup const& get()
+		{
+			static ExtendedLookup const lookup = build();
+			return lookup;
+		}
+
+		static ExtendedLookup build()
+		{
+			FigureGenerator generator;
+			generator.initLookupTableValidity();
+
+			// The window is a 25 bits board, bit (5 * row + col), the top row being 0.
+			constexpr uint32_t Full = (1u << 25) - 1;
+			constexpr uint32_t Center = 1u << 12;
+			constexpr uint32_t Inner = 0b01110'01010'01110u << 5;
+			constexpr uint32_t Border = Full & ~Inner & ~Center;
+			constexpr uint32_t ColLeft = 0b00001'00001'00001'00001'00001u;
+			constexpr uint32_t ColRight = ColLeft << 4;
+			// Cells in the order of getNeighbourhood() and getOuterNeighbourhood().
+			constexpr uint8_t InnerCells[8] = { 6, 7, 8, 11, 13, 16, 17, 18 };
+			constexpr uint8_t OuterCells[16] = { 0, 1, 2, 3, 4, 5, 9, 10, 14, 15, 19, 20, 21, 22, 23, 24 };
+
+			auto funcDilate = [] (uint32_t m) {
+				uint32_t h = m | ((m << 1) & ~ColLeft) | ((m >> 1) & ~ColRight);
+				return (h | (h << 5) | (h >> 5)) & Full;
+			};
+			// Pixels of 'allowed' connected to 'seed'.
+			auto funcFlood = [funcDilate] (uint32_t seed, uint32_t allowed) {
+				for (uint32_t next; (next = funcDilate(seed) & allowed) != seed; )
+					seed = next;
+				return seed;
+			};
+
+			ExtendedLookup lookup{};
+			uint32_t rejectedCount = 0;
+			for (uint32_t n = 0; n < 256; ++n)
+				if (not generator.validityLookup.table[n])
+					lookup.innerIndices[n] = rejectedCount++;
+			lookup.results.resize(rejectedCount * 65536 / 4);
+
+			// Black pixels of the board, for the low and high bytes of the outer neighbourhood.
+			uint32_t outerBlack[512] = {};
+			for (uint32_t m = 0; m < 256; ++m) {
+				for (uint32_t k = 0; k < 8; ++k) {
+					if ((m >> k) & 1) {
+						outerBlack[m] |= 1u << OuterCells[k];
+						outerBlack[256 + m] |= 1u << OuterCells[8 + k];
+					}
+				}
+			}
+
+			for (uint32_t n = 0; n < 256; ++n) {
+				if (generator.validityLookup.table[n])
+					continue;
+				uint32_t black = Center;
+				for (uint32_t k = 0; k < 8; ++k)
+					if ((n >> k) & 1)
+						black |= 1u << InnerCells[k];
+
+				for (uint32_t outer = 0; outer < 65536; ++outer) {
+					uint32_t white = ~black & ~outerBlack[outer & 255] & ~outerBlack[256 + (outer >> 8)] & Full;
+
+					// Valid if the white pixels around the new pixel are in one component.
+					// Else, invalid if some of them are not connected to the border of the window.
+					uint32_t around = white & Inner;
+					Result result = Valid;
+					if (around & ~funcFlood(around & (~around + 1), white)) {
+						uint32_t outside = funcFlood(white & Border, white);
+						result = (around & ~outside ? Invalid : Unknown);
+					}
+
+					uint32_t idx = (lookup.innerIndices[n] << 16) | outer;
+					lookup.results[idx / 4] |= result << (2 * (idx % 4));
+				}
+			}
+			return lookup;
+		}
+	};
+
+	/// Only used for connectivity (8,8): proper graph traversal among the white pixels,
+	/// when the neighbourhood of the last chosen pixel is not enough to conclude.
+	bool checkValidityGlobal()
+	{
+		if constexpr (bStats)
+			++stats.slowPath;
+		// White neighbours are candidates, except chosen pixels.
+		for (uint32_t k = 0; k < BitGrid::U64size; ++k)
+			visit.grid.u64[k] = gridCandidates.u64[k] & ~gridChosen.u64[k];
+
+		// In gridCandidates, we also have all pos before PosOrigin.
+		// Among them, all pos before (PosOrigin + DirDownLeft) are
+		//_not necessary to visit.
+		constexpr Pos FirstVisitPos = (PosOrigin + DirDownLeft);
+		for (uint32_t k = 0; k < FirstVisitPos / 64; ++k)
+			visit.grid.u64[k] = 0;
+		for (Pos p = ((FirstVisitPos / 64) * 64); p <= FirstVisitPos; ++p)
+			visit.grid.reset(p);
+
+		visit.count = 1;
+		visit.queue[0] = FirstVisitPos;
+
+		auto funcVisit = [this](Pos pos) {
+			if (visit.grid.get(pos)) {
+				visit.grid.reset(pos);
+				visit.queue[visit.count] = pos;
+				++visit.count;
+			}
+			};
+
+		while (visit.count > 0) {
+			--visit.count;
+			Pos p = visit.queue[visit.count];
+			if constexpr (bStats)
+				++stats.visitedCells;
+			funcVisit(p + DirRight);
+			funcVisit(p + DirUpRight);
+			funcVisit(p + DirUp);
+			funcVisit(p + DirUpLeft);
+			funcVisit(p + DirLeft);
+			funcVisit(p + DirDownLeft);
+			funcVisit(p + DirDown);
+			funcVisit(p + DirDownRight);
+		}
+		// If there is any gridVisit pixel not visited, reject.
+		for (uint32_t k = 0; k < BitGrid::U64size; ++k)
+			if (visit.grid.u64[k])
+				return false;
+		return true;
+	}
+
 	void initLookupTableValidity()
 	{
 		if constexpr (B != 0) {
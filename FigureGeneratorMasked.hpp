@@ -0,0 +1,230 @@
+#pragma once
+
+#include "FigureGenerator.hpp"
+
+/// Variant of FigureGenerator where, when entering a level, the validity lookup is
+/// evaluated for all siblings at once, since they are all tested against the same
+/// parent figure. The results are stored as a bitmask per level, and moving to the
+/// next sibling jumps directly to the next valid candidate.
+/// Children at the maximum level are iterated directly from the bitmask of their parent.
+///
+/// For (8,8), the bitmask only tells which siblings are accepted by the lookup,
+/// the others still need the extended lookup, and maybe the graph traversal.
+template<uint32_t Nmax, uint32_t A, uint32_t B, bool bStats = false>
+struct FigureGeneratorMasked : FigureGenerator<Nmax, A, B, bStats>
+{
+	using Base = FigureGenerator<Nmax, A, B, bStats>;
+	using typename Base::Pos;
+	using Base::level;
+	using Base::count;
+	using Base::candidates;
+	using Base::candidateCounts;
+	using Base::chosenIndices;
+	using Base::gridCandidates;
+	using Base::gridChosen;
+	using Base::validityLookup;
+	using Base::stats;
+
+	static constexpr bool bExactMask = !(A == 8 && B == 8);
+	static constexpr uint32_t MaskSize = (sizeof(Base::candidates) / sizeof(Pos) + 63) / 64;
+
+	// Bit 'idx' of validMasks[level] is set if candidates[idx] is accepted by the lookup,
+	// for indices between chosenIndices[level] and count.
+	uint64_t validMasks[Nmax][MaskSize];
+
+	void init()
+	{
+		Base::init();
+		for (uint32_t k = 0; k < MaskSize; ++k)
+			validMasks[0][k] = 0;
+	}
+
+	/// Same as FigureGenerator::generate().
+	template <typename Func>
+	void generate(Func&& callbackNewFigure, uint32_t nmax = Nmax)
+	{
+		if (nmax > Nmax)
+			nmax = Nmax;
+		uint32_t maxLevel = nmax - 1;
+
+		// Current figure is always valid.
+		while (true) {
+			callbackNewFigure();
+			if (level + 1 < maxLevel) {
+				if (firstValidChild())
+					continue;
+			}
+			else if (level + 1 == maxLevel) {
+				leafChildren(callbackNewFigure);
+			}
+			else if constexpr (bStats) {
+				++stats.nonLeaf;
+			}
+			while (not nextValidSibling()) {
+				if (level == 0)
+					return;
+				Base::parent();
+			}
+		}
+	}
+
+	/// Adds the candidates of the current figure, computes the validity bitmask
+	/// of the new level, and goes to the first valid child.
+	/// @retval false if there is no valid child, the state is unchanged.
+	bool firstValidChild()
+	{
+		uint32_t idx = chosenIndices[level];
+		uint32_t oldCount = count;
+		Base::addCandidates(candidates[idx]);
+		if (idx + 1 == count) {
+			if constexpr (bStats)
+				++stats.nonLeaf;
+			return false;
+		}
+		if constexpr (bStats)
+			++stats.leaf;
+
+		uint64_t* mask = validMasks[level + 1];
+		computeMask(mask, idx + 1);
+		uint32_t j = idx + 1;
+		if (not findValid(mask, j)) {
+			if constexpr (bStats)
+				stats.rejected += count - idx - 1;
+			for (uint32_t k = oldCount; k < count; ++k)
+				gridCandidates.reset(candidates[k]);
+			count = oldCount;
+			return false;
+		}
+
+		if constexpr (bStats)
+			stats.rejected += j - idx - 1;
+		++level;
+		candidateCounts[level] = count;
+		chosenIndices[level] = j;
+		if constexpr (B != 0)
+			gridChosen.set(candidates[j]);
+		return true;
+	}
+
+	/// Calls callbackNewFigure() for each valid child of the current figure, which are
+	/// at the maximum level. As they have no children, gridChosen is not updated for them.
+	/// The state is unchanged at the end.
+	template <typename Func>
+	void leafChildren(Func& callbackNewFigure)
+	{
+		uint32_t idx = chosenIndices[level];
+		uint32_t oldCount = count;
+		Base::addCandidates(candidates[idx]);
+		if (idx + 1 == count) {
+			if constexpr (bStats)
+				++stats.nonLeaf;
+			return;
+		}
+		if constexpr (bStats)
+			++stats.leaf;
+
+		uint64_t* mask = validMasks[level + 1];
+		computeMask(mask, idx + 1);
+		++level;
+		candidateCounts[level] = count;
+		uint32_t validCount = 0;
+		for (uint32_t j = idx + 1; findValid(mask, j); ++j) {
+			chosenIndices[level] = j;
+			callbackNewFigure();
+			++validCount;
+		}
+		--level;
+
+		if constexpr (bStats) {
+			stats.nonLeaf += validCount;
+			stats.rejected += count - idx - 1 - validCount;
+		}
+		for (uint32_t k = oldCount; k < count; ++k)
+			gridCandidates.reset(candidates[k]);
+		count = oldCount;
+	}
+
+	/// One sweep over candidates, from 'first' to count, against the current figure.
+	/// Without white connectivity, all candidates are valid and no mask is needed.
+	void computeMask(uint64_t* mask, uint32_t first)
+	{
+		if constexpr (B != 0) {
+			for (uint32_t k = 0; k < MaskSize; ++k) {
+				uint32_t begin = (first > k * 64 ? first : k * 64);
+				uint32_t end = (count < (k + 1) * 64 ? count : (k + 1) * 64);
+				uint64_t word = 0;
+				for (uint32_t j = begin; j < end; ++j) {
+					uint8_t neighbourhood = Base::getNeighbourhood(candidates[j]);
+					uint64_t bValid = validityLookup.table[neighbourhood];
+					word |= bValid << (j % 64);
+					// For (8,8), rejections are only counted after the extended check.
+					if constexpr (bStats)
+						if (bValid || bExactMask)
+							++(bValid ? stats.patternAccepted : stats.patternRejected)[neighbourhood];
+				}
+				mask[k] = word;
+			}
+		}
+	}
+
+	/// Goes to the next valid sibling.
+	/// @retval false if there is none, the current figure is unchanged.
+	bool nextValidSibling()
+	{
+		uint32_t idx = chosenIndices[level];
+		uint32_t j = idx + 1;
+		if constexpr (B != 0)
+			gridChosen.reset(candidates[idx]);
+		if (not findValid(validMasks[level], j)) {
+			if constexpr (B != 0)
+				gridChosen.set(candidates[idx]);
+			if constexpr (bStats)
+				stats.rejected += count - idx - 1;
+			return false;
+		}
+		if constexpr (bStats)
+			stats.rejected += j - idx - 1;
+		if constexpr (B != 0)
+			gridChosen.set(candidates[j]);
+		chosenIndices[level] = j;
+		return true;
+	}
+
+	/// Finds the first valid candidate at index 'j' or after, below count.
+	/// gridChosen must contain the parent figure, and is left unchanged.
+	/// For (8,8), candidates rejected by the lookup are checked by graph traversal.
+	bool findValid(uint64_t const* mask, uint32_t& j)
+	{
+		if constexpr (B == 0) {
+			return j < count;
+		}
+		else if constexpr (bExactMask) {
+			if (j >= count)
+				return false;
+			uint32_t k = j / 64;
+			uint64_t bits = mask[k] & (~(uint64_t)0 << (j % 64));
+			while (bits == 0) {
+				if (++k * 64 >= count)
+					return false;
+				bits = mask[k];
+			}
+			j = k * 64 + countTrailingZeros(bits);
+			return j < count;
+		}
+		else {
+			for (; j < count; ++j) {
+				if ((mask[j / 64] >> (j % 64)) & 1)
+					return true;
+				uint8_t neighbourhood = Base::getNeighbourhood(candidates[j]);
+				gridChosen.set(candidates[j]);
+				bool bValid = Base::checkValidityExtended(candidates[j], neighbourhood);
+				gridChosen.reset(candidates[j]);
+				if constexpr (bStats)
+					++(bValid ? stats.patternAccepted : stats.patternRejected)[neighbourhood];
+				if (bValid)
+					return true;
+			}
+			return false;
+		}
+	}
+};
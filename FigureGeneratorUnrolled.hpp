@@ -0,0 +1,97 @@
+#pragma once
+
+#include "FigureGenerator.hpp"
+
+/// Variant of FigureGenerator where the last K levels, which hold most of the figures,
+/// are iterated by a recursive kernel unrolled at compile time: the depth is a template
+/// parameter, so there is no check of the maximum level, and the candidate count and the
+/// index of the chosen candidate stay in locals. 'level' and 'chosenIndices' are only
+/// written so that the callback sees the same state as with FigureGenerator.
+/// @tparam K Number of levels iterated by the kernel.
+template<uint32_t Nmax, uint32_t A, uint32_t B, uint32_t K>
+struct FigureGeneratorUnrolled : FigureGenerator<Nmax, A, B>
+{
+	static_assert(K >= 1 && K < Nmax);
+
+	using Base = FigureGenerator<Nmax, A, B>;
+	using typename Base::Pos;
+	using Base::level;
+	using Base::count;
+	using Base::candidates;
+	using Base::chosenIndices;
+	using Base::gridCandidates;
+	using Base::gridChosen;
+
+	/// Same as FigureGenerator::generate().
+	template <typename Func>
+	void generate(Func&& callbackNewFigure, uint32_t nmax = Nmax)
+	{
+		if (nmax > Nmax)
+			nmax = Nmax;
+		uint32_t maxLevel = nmax - 1;
+		// Descendants of figures at tailLevel are iterated by the kernel.
+		uint32_t tailDepth = (maxLevel < K ? maxLevel : K);
+		uint32_t tailLevel = maxLevel - tailDepth;
+
+		while (true) {
+			while (Base::checkValidity()) {
+				callbackNewFigure();
+				if (level == tailLevel) {
+					tailDispatch<K>(tailDepth, callbackNewFigure);
+					break;
+				}
+				else if (not Base::firstChild()) {
+					break;
+				}
+			}
+			while (not Base::nextSibling()) {
+				if (level == 0)
+					return;
+				Base::parent();
+			}
+		}
+	}
+
+	/// Calls tail<depth>(), for a depth only known at runtime, between 0 and Depth.
+	template<uint32_t Depth, typename Func>
+	void tailDispatch(uint32_t depth, Func& callbackNewFigure)
+	{
+		if (depth == Depth)
+			tail<Depth>(callbackNewFigure);
+		else if constexpr (Depth > 1)
+			tailDispatch<Depth - 1>(depth, callbackNewFigure);
+	}
+
+	/// Calls callbackNewFigure() for each descendant of the current figure,
+	/// over the next Depth levels. The state is unchanged at the end.
+	template<uint32_t Depth, typename Func>
+	void tail(Func& callbackNewFigure)
+	{
+		uint32_t parentLevel = level;
+		uint32_t idx = chosenIndices[parentLevel];
+		uint32_t oldCount = count;
+		Base::addCandidates(candidates[idx]);
+		uint32_t newCount = count;
+
+		level = parentLevel + 1;
+		for (uint32_t j = idx + 1; j < newCount; ++j) {
+			Pos pos = candidates[j];
+			if constexpr (Base::HasGridChosen)
+				gridChosen.set(pos);
+			if (Base::checkValidityAt(pos)) {
+				chosenIndices[parentLevel + 1] = j;
+				callbackNewFigure();
+				if constexpr (Depth > 1) {
+					tail<Depth - 1>(callbackNewFigure);
+				}
+			}
+			if constexpr (Base::HasGridChosen)
+				gridChosen.reset(pos);
+		}
+		level = parentLevel;
+
+		for (uint32_t k = oldCount; k < newCount; ++k)
+			gridCandidates.reset(candidates[k]);
+		count = oldCount;
+	}
+};
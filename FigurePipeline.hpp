@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/// Bounded lock-free queue, with a single producer thread and a single consumer thread.
+/// When the queue is full, the producer waits for the consumer (backpressure).
+/// @tparam T Type of the elements, copied in place.
+/// @tparam Capacity Maximum number of elements, must be a power of two.
+template<typename T, size_t Capacity>
+struct SpscRing
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	// Indices are increasing forever, the slot is (index % Capacity).
+	// Each index is on its own cache line to prevent false sharing.
+	alignas(64) std::atomic<size_t> head{}; // Next slot to be written by the producer.
+	alignas(64) std::atomic<size_t> tail{}; // Next slot to be read by the consumer.
+	alignas(64) std::atomic<bool> closed{}; // Set by the producer after its last push.
+
+	// Local copies, to avoid reading the other thread's index at each operation.
+	alignas(64) size_t producerHead = 0;
+	size_t producerTailCache = 0;
+	alignas(64) size_t consumerTail = 0;
+	size_t consumerHeadCache = 0;
+
+	alignas(64) T slots[Capacity];
+
+	/// Producer side: returns the next slot to be written, waiting if the queue is full.
+	/// The element is only visible to the consumer after commitPush().
+	T& pushSlot()
+	{
+		while (producerHead - producerTailCache >= Capacity) {
+			producerTailCache = tail.load(std::memory_order_acquire);
+			if (producerHead - producerTailCache >= Capacity)
+				std::this_thread::yield();
+		}
+		return slots[producerHead % Capacity];
+	}
+
+	/// Producer side: publishes the slot returned by pushSlot().
+	void commitPush()
+	{
+		++producerHead;
+		head.store(producerHead, std::memory_order_release);
+	}
+
+	/// Producer side: signals no more elements will be pushed.
+	void close()
+	{
+		closed.store(true, std::memory_order_release);
+	}
+
+	/// Consumer side: calls func(elements, count) on a contiguous batch of available elements.
+	/// @param maxCount Maximum number of elements in the batch.
+	/// @return Number of consumed elements, 0 if the queue is empty.
+	template<typename Func>
+	size_t popBatch(Func&& func, size_t maxCount = Capacity)
+	{
+		if (consumerTail == consumerHeadCache) {
+			consumerHeadCache = head.load(std::memory_order_acquire);
+			if (consumerTail == consumerHeadCache)
+				return 0;
+		}
+		size_t count = consumerHeadCache - consumerTail;
+		size_t slot = consumerTail % Capacity;
+		// Do not wrap around the end of the array.
+		if (count > Capacity - slot)
+			count = Capacity - slot;
+		if (count > maxCount)
+			count = maxCount;
+		func(&slots[slot], count);
+		consumerTail += count;
+		tail.store(consumerTail, std::memory_order_release);
+		return count;
+	}
+
+	/// Consumer side: whether the producer has closed the queue and all elements are consumed.
+	bool finished()
+	{
+		// 'closed' must be read before 'head', else a last push could be missed.
+		if (not closed.load(std::memory_order_acquire))
+			return false;
+		return consumerTail == head.load(std::memory_order_acquire);
+	}
+};
+
+/// Pipeline stage: producers push records into their own SpscRing,
+/// and a pool of consumer threads processes them by batches.
+/// Ring i is consumed by consumer (i % consumerCount), so each ring has a single consumer.
+/// @tparam Record Type of the elements transmitted.
+/// @tparam RingCapacity Number of records per ring, must be a power of two.
+template<typename Record, size_t RingCapacity = 1024>
+struct FigurePipeline
+{
+	using Ring = SpscRing<Record, RingCapacity>;
+
+	std::vector<std::unique_ptr<Ring>> rings;
+	std::vector<std::thread> consumers;
+	std::atomic<uint32_t> nextRing{};
+
+	/// Starts the consumer threads.
+	/// @param producerCount Maximum number of calls to acquireRing().
+	/// @param consumerCount Number of consumer threads.
+	/// @param consume Called as consume(consumerIndex, records, count) for each batch,
+	///        consumerIndex being in [0, consumerCount).
+	template<typename Func>
+	void start(uint32_t producerCount, uint32_t consumerCount, Func consume)
+	{
+		rings.clear();
+		for (uint32_t i = 0; i < producerCount; ++i)
+			rings.emplace_back(std::make_unique<Ring>());
+		nextRing = 0;
+
+		for (uint32_t c = 0; c < consumerCount; ++c) {
+			consumers.emplace_back([this, c, consumerCount, consume] {
+				while (true) {
+					bool bFinished = true;
+					size_t popped = 0;
+					for (size_t i = c; i < rings.size(); i += consumerCount) {
+						Ring& ring = *rings[i];
+						popped += ring.popBatch([&] (Record const* records, size_t count) {
+							consume(c, records, count);
+						});
+						bFinished = bFinished && ring.finished();
+					}
+					if (bFinished)
+						return;
+					if (popped == 0)
+						std::this_thread::yield();
+				}
+			});
+		}
+	}
+
+	/// Gives a ring to a new producer, which must close() it when done.
+	Ring& acquireRing()
+	{
+		return *rings[nextRing++];
+	}
+
+	/// Closes unused rings, and waits for consumers to process all records.
+	void finish()
+	{
+		for (uint32_t i = nextRing; i < rings.size(); ++i)
+			rings[i]->close();
+		for (std::thread& consumer : consumers)
+			consumer.join();
+		consumers.clear();
+	}
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/// Compact encoding of a figure, independent of its position in the grid:
+/// its size, its bounding box, and one bitmask per row.
+/// Bit x of rows[y] is set if pixel (x,y) is chosen, (0,0) being the bottom-left
+/// of the bounding box. Rows above the height are zero, so records can be compared bytewise.
+/// @tparam Nmax Maximum size of the figures.
+template<uint32_t Nmax>
+struct FigureRecord
+{
+	using Row = std::conditional_t<(Nmax <= 32), uint32_t, uint64_t>;
+
+	uint8_t size;
+	uint8_t width;
+	uint8_t height;
+	uint8_t reserved;
+	Row rows[Nmax];
+
+	/// Encodes the current figure of a FigureGenerator.
+	/// Only encoding is limited to Nmax <= 64, so builds which never encode figures can hold
+	/// records of a bigger Nmax, always empty.
+	template<typename FigGenerator>
+	void assign(FigGenerator const& generator)
+	{
+		static_assert(Nmax <= 64 && FigGenerator::Width <= 2 * (int32_t)Nmax + 3, "Rows are stored in at most 64 bits");
+		using Pos = typename FigGenerator::Pos;
+		constexpr int32_t Width = FigGenerator::Width;
+		constexpr int32_t OriginRow = FigGenerator::OriginRow;
+
+		uint32_t level = generator.level;
+		int32_t xmin = Width, xmax = 0, ymax = 0;
+		for (uint32_t k = 0; k <= level; ++k) {
+			Pos pos = generator.candidates[generator.chosenIndices[k]];
+			int32_t x = pos % Width, y = pos / Width;
+			xmin = (x < xmin ? x : xmin);
+			xmax = (x > xmax ? x : xmax);
+			ymax = (y > ymax ? y : ymax);
+		}
+
+		memset(this, 0, sizeof(*this));
+		size = level + 1;
+		width = xmax - xmin + 1;
+		height = ymax - OriginRow + 1;
+		for (uint32_t k = 0; k <= level; ++k) {
+			Pos pos = generator.candidates[generator.chosenIndices[k]];
+			int32_t x = pos % Width, y = pos / Width;
+			rows[y - OriginRow] |= (Row)1 << (x - xmin);
+		}
+	}
+
+	bool get(uint32_t x, uint32_t y) const
+	{
+		return (rows[y] >> x) & 1;
+	}
+
+	/// Writes the rows from top to bottom, separated by '/', with 'X' for chosen pixels
+	/// and '.' for others. 'out' must have at least ReprSize bytes, it is null-terminated.
+	static constexpr uint32_t ReprSize = (Nmax + 1) * Nmax;
+	void repr(char* out) const
+	{
+		for (int32_t y = height - 1; y >= 0; --y) {
+			for (uint32_t x = 0; x < width; ++x)
+				*out++ = get(x, y) ? 'X' : '.';
+			*out++ = (y > 0 ? '/' : '\0');
+		}
+	}
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "FigureRecord.hpp"
+#include "FigureFiles.hpp"
+#include <stdio.h>
+#include <string.h>
+
+/// Renders figures cropped to their bounding box, as text or as PBM images,
+/// or their chain codes from FigureContour, in bulk.
+///
+/// Rows of FigureRecord are expanded a byte at a time with lookup tables: 8 characters
+/// per byte for text, and the byte with reversed bits for PBM, where the leftmost pixel
+/// is the most significant bit. Text has the rows from top to bottom, 'X' for chosen pixels
+/// and '.' for others, and an empty line after each figure. PBM has one binary image (P4)
+/// per figure, concatenated, which netpbm tools read as a multi-image file.
+/// Chain codes are written as their number in two bytes, little-endian, as there are up to
+/// 4 Nmax of them, then 4 codes per byte, the first one in the least significant bits.
+///
+/// Each worker renders into its own buffer of BufferSize bytes.
+/// @tparam Nmax Maximum size of the figures.
+template<uint32_t Nmax>
+struct FigureRenderer : FigureFileWriter<1>
+{
+	using Record = FigureRecord<Nmax>;
+	using Row = typename Record::Row;
+
+	enum Format : uint32_t { FormatText, FormatPbm, FormatChain };
+
+	static constexpr size_t BufferSize = 1 << 20;
+	// Upper bound of the bytes of a figure, with 8 bytes of slack for whole-byte expansion.
+	static constexpr size_t MaxFigureBytes = 32 + Nmax * (Nmax + 1) + 8;
+
+	struct Tables
+	{
+		char text[256][8];
+		uint8_t reversed[256];
+
+		Tables()
+		{
+			for (uint32_t b = 0; b < 256; ++b) {
+				reversed[b] = 0;
+				for (uint32_t i = 0; i < 8; ++i) {
+					text[b][i] = ((b >> i) & 1) ? 'X' : '.';
+					reversed[b] |= ((b >> i) & 1) << (7 - i);
+				}
+			}
+		}
+	};
+	inline static Tables const tables;
+
+	Format format = FormatText;
+
+	bool open(char const* path, Format fileFormat)
+	{
+		reset();
+		format = fileFormat;
+		return openFile(0, path, "wb");
+	}
+
+	Buffer makeBuffer() const
+	{
+		return FigureFileWriter::makeBuffer({ BufferSize });
+	}
+
+	/// Appends the current figure of a generator to the buffer of the calling worker.
+	template<typename FigGenerator>
+	void add(Buffer& buffer, FigGenerator const& generator)
+	{
+		Record record;
+		record.assign(generator);
+		add(buffer, record);
+	}
+
+	void add(Buffer& buffer, Record const& record)
+	{
+		if (buffer.used[0] + MaxFigureBytes > BufferSize)
+			flush(buffer);
+		char* out = (char*)buffer.data[0].data() + buffer.used[0];
+		char* begin = out;
+		uint32_t width = record.width;
+		uint32_t rowBytes = (width + 7) / 8;
+		if (format == FormatText) {
+			for (int32_t y = record.height - 1; y >= 0; --y) {
+				Row row = record.rows[y];
+				for (uint32_t k = 0; k < rowBytes; ++k) {
+					memcpy(out, tables.text[(row >> (8 * k)) & 0xFF], 8);
+					out += (k + 1 < rowBytes ? 8 : width - 8 * k);
+				}
+				*out++ = '\n';
+			}
+			*out++ = '\n';
+		}
+		else {
+			memcpy(out, "P4\n", 3);
+			out = writeNumber(out + 3, width);
+			*out++ = ' ';
+			out = writeNumber(out, record.height);
+			*out++ = '\n';
+			for (int32_t y = record.height - 1; y >= 0; --y) {
+				Row row = record.rows[y];
+				for (uint32_t k = 0; k < rowBytes; ++k)
+					*out++ = (char)tables.reversed[(row >> (8 * k)) & 0xFF];
+			}
+		}
+		buffer.used[0] += out - begin;
+		++buffer.figures;
+	}
+
+	/// Appends chain codes, as given by FigureContour::trace(), with FormatChain.
+	void addChain(Buffer& buffer, uint8_t const* codes, uint32_t length)
+	{
+		static_assert(4 * Nmax <= UINT16_MAX, "The number of chain codes is written in 16 bits");
+		if (buffer.used[0] + MaxFigureBytes > BufferSize)
+			flush(buffer);
+		uint8_t* out = buffer.data[0].data() + buffer.used[0];
+		*out++ = (uint8_t)length;
+		*out++ = (uint8_t)(length >> 8);
+		for (uint32_t k = 0; k < length; k += 4) {
+			uint8_t packed = codes[k];
+			for (uint32_t i = 1; i < 4 && k + i < length; ++i)
+				packed |= codes[k + i] << (2 * i);
+			*out++ = packed;
+		}
+		buffer.used[0] += 2 + (length + 3) / 4;
+		++buffer.figures;
+	}
+
+	/// Writes the decimal representation of a number < 100, not null-terminated.
+	static char* writeNumber(char* out, uint32_t number)
+	{
+		if (number >= 10)
+			*out++ = (char)('0' + number / 10);
+		*out++ = (char)('0' + number % 10);
+		return out;
+	}
+};
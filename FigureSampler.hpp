@@ -0,0 +1,122 @@
+#pragma once
+
+#include "FigureRecord.hpp"
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/// Uniform random sample of k figures per level, without replacement, gathered during
+/// an enumeration (reservoir sampling). Figures are only encoded when they enter the sample,
+/// and the expected number of random draws is O(k log(N/k)) for N figures (Li's Algorithm L),
+/// so the cost per figure is a counter increment and a comparison.
+///
+/// Each worker has its own sampler. Samplers of disjoint sets of figures are merged
+/// with weights, so the result is a uniform sample of the union.
+/// @tparam Nmax Maximum size of the figures.
+template<uint32_t Nmax>
+struct FigureSampler
+{
+	using Record = FigureRecord<Nmax>;
+
+	struct Level
+	{
+		uint64_t seen = 0;       // Number of figures offered to this level.
+		uint64_t nextAccept = 0; // Index of the next figure entering the sample.
+		double w = 0;            // Algorithm L state, once the sample is full.
+		std::vector<Record> records;
+	};
+
+	uint32_t k = 0;
+	std::mt19937_64 rng;
+	Level levels[Nmax];
+
+	void init(uint32_t sampleSize, uint64_t seed)
+	{
+		k = sampleSize;
+		rng.seed(seed);
+		for (Level& level : levels) {
+			level = {};
+			level.records.reserve(k);
+		}
+	}
+
+	/// Offers the current figure of the generator to the sample of its level.
+	template<typename FigGenerator>
+	void offer(FigGenerator const& generator)
+	{
+		Level& level = levels[generator.level];
+		uint64_t i = level.seen++;
+		if (i == level.nextAccept)
+			accept(level, i, generator);
+	}
+
+	template<typename FigGenerator>
+	void accept(Level& level, uint64_t i, FigGenerator const& generator)
+	{
+		if (k == 0) {
+			level.nextAccept = UINT64_MAX;
+			return;
+		}
+		if (level.records.size() < k) {
+			level.records.emplace_back().assign(generator);
+			level.nextAccept = i + 1;
+			if (level.records.size() == k) {
+				level.w = exp(log(uniform()) / k);
+				level.nextAccept = i + skip(level.w) + 1;
+			}
+		}
+		else {
+			level.records[rng() % k].assign(generator);
+			level.w *= exp(log(uniform()) / k);
+			level.nextAccept = i + skip(level.w) + 1;
+		}
+	}
+
+	/// Merges the sample of another sampler, whose figures are disjoint from ours.
+	/// Each kept figure comes from this or the other sample with a probability proportional
+	/// to the remaining population of each side, so the merged sample stays uniform.
+	void merge(FigureSampler& other)
+	{
+		for (uint32_t l = 0; l < Nmax; ++l) {
+			Level& mine = levels[l];
+			Level& theirs = other.levels[l];
+			std::shuffle(mine.records.begin(), mine.records.end(), rng);
+			std::shuffle(theirs.records.begin(), theirs.records.end(), rng);
+
+			uint64_t remainingMine = mine.seen, remainingTheirs = theirs.seen;
+			uint64_t total = remainingMine + remainingTheirs;
+			uint64_t sampleSize = (total < k ? total : k);
+			size_t takenMine = 0, takenTheirs = 0;
+			for (uint64_t j = 0; j < sampleSize; ++j) {
+				if (rng() % (remainingMine + remainingTheirs) < remainingMine) {
+					++takenMine;
+					--remainingMine;
+				}
+				else {
+					++takenTheirs;
+					--remainingTheirs;
+				}
+			}
+			mine.records.resize(takenMine);
+			mine.records.insert(mine.records.end(),
+				theirs.records.begin(), theirs.records.begin() + takenTheirs);
+			mine.seen += theirs.seen;
+			// A merged sampler is not meant to receive more figures.
+			mine.nextAccept = UINT64_MAX;
+		}
+	}
+
+	/// Uniform in (0, 1].
+	double uniform()
+	{
+		return ((rng() >> 11) + 1) * (1.0 / 9007199254740992.0);
+	}
+
+	/// Number of figures to skip before the next one enters the sample.
+	uint64_t skip(double w)
+	{
+		double s = floor(log(uniform()) / log1p(-w));
+		return (s < 1e18 ? (uint64_t)s : UINT64_MAX / 2);
+	}
+};
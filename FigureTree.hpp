@@ -0,0 +1,110 @@
+#pragma once
+
+#include "FigureFiles.hpp"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+/// Writes the Redelmeier tree of an enumeration, one fixed-width node per figure,
+/// for analysis of its structure by memory mapping the file.
+///
+/// The id of a node is its index in the file, after a header of HeaderSize bytes.
+/// Ids are allocated by blocks of BlockSize from a shared atomic counter: each worker fills
+/// its own block, and writes it at its place in the file when full, so ids are consistent
+/// between workers without a lock per node. Slots of a block which are not used by the end
+/// have level Unused.
+/// @tparam Nmax Maximum size of the figures.
+template<uint32_t Nmax>
+struct FigureTreeWriter : FigureFileWriter<1>
+{
+	static constexpr size_t BlockSize = 4096;
+	static constexpr size_t HeaderSize = 64;
+	static constexpr uint64_t NoParent = UINT64_MAX;
+	static constexpr uint8_t Unused = 0xFF;
+
+	struct Node
+	{
+		uint64_t parent;         // Id of the parent node, NoParent for the root.
+		uint16_t chosenIndex;    // Index of the chosen candidate of the figure.
+		uint16_t candidateCount; // Number of candidates when it was chosen.
+		uint8_t level;           // Size of the figure - 1, or Unused.
+		uint8_t reserved[3];
+	};
+	static_assert(sizeof(Node) == 16);
+
+	/// First bytes of the file: magic, then little-endian uint32 of the node size, Nmax,
+	/// and the connectivities. Zero-padded to HeaderSize.
+	struct Header
+	{
+		char magic[8];
+		uint32_t nodeSize;
+		uint32_t nmax;
+		uint32_t a;
+		uint32_t b;
+		uint8_t padding[HeaderSize - 24];
+	};
+	static_assert(sizeof(Header) == HeaderSize);
+
+	/// Buffer of a worker, holding one block of nodes.
+	struct Arena : Buffer
+	{
+		uint64_t first = 0; // Id of the first node of the block.
+	};
+
+	std::atomic<uint64_t> nextId{};
+
+	bool open(char const* path, uint32_t a, uint32_t b)
+	{
+		reset();
+		nextId = 0;
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "FIGTREE", 8);
+		header.nodeSize = sizeof(Node);
+		header.nmax = Nmax;
+		header.a = a;
+		header.b = b;
+		return openFile(0, path, "wb", &header, sizeof(header));
+	}
+
+	/// Adds the current figure of a generator, whose parent has id 'parent',
+	/// and returns its id.
+	template<typename FigGenerator>
+	uint64_t add(Arena& arena, FigGenerator const& generator, uint64_t parent)
+	{
+		if (arena.used[0] == 0 || arena.figures == BlockSize)
+			nextBlock(arena);
+		Node node;
+		memset(&node, 0, sizeof(node));
+		uint32_t level = generator.level;
+		node.parent = parent;
+		node.chosenIndex = (uint16_t)generator.chosenIndices[level];
+		node.candidateCount = (uint16_t)generator.count;
+		node.level = (uint8_t)level;
+		memcpy(&arena.data[0][arena.figures * sizeof(Node)], &node, sizeof(node));
+		return arena.first + arena.figures++;
+	}
+
+	void nextBlock(Arena& arena)
+	{
+		if (arena.used[0] != 0)
+			flush(arena);
+		Node unused;
+		memset(&unused, 0, sizeof(unused));
+		unused.parent = NoParent;
+		unused.level = Unused;
+		arena.data[0].resize(BlockSize * sizeof(Node));
+		for (size_t k = 0; k < BlockSize; ++k)
+			memcpy(&arena.data[0][k * sizeof(Node)], &unused, sizeof(unused));
+		arena.used[0] = BlockSize * sizeof(Node);
+		arena.first = (nextId += BlockSize) - BlockSize;
+	}
+
+	/// Writes the block of an arena at its place, unused slots included. Called when the block
+	/// is full, and once per worker after its last figure.
+	void flush(Arena& arena)
+	{
+		FigureFileWriter::flush(arena, (int64_t)(HeaderSize + arena.first * sizeof(Node)));
+	}
+};
@@ -0,0 +1,445 @@
+#pragma once
+
+#include "FigureGenerator.hpp"
+#include "FigureRecord.hpp"
+#include "FigureFiles.hpp"
+#include "BS_thread_pool.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+/// Generation of free figures (up to translation, rotation and reflection), level by level,
+/// with files as intermediate storage, so the sets of figures can be bigger than the memory.
+///
+/// The file of size n holds the canonical FigureRecord of each free figure, sorted bytewise
+/// and unique. It is generated from the file of size n - 1: parents are read by chunks, their
+/// children are computed and canonicalized on the threads of a pool, then each chunk is sorted
+/// and written as a run, and the runs are merged without duplicates into the file of size n.
+/// Existing files are reused, so sets materialized by a previous run are not generated again.
+/// As the layout of FigureRecord depends on Nmax, file names include it, and files which are not
+/// made of whole records are rejected.
+///
+/// Every valid figure has a valid parent, the figure before its last pixel in the enumeration
+/// tree of FigureGenerator, so extending all valid figures of size n - 1 finds all of size n.
+/// @tparam Nmax Maximum size of the figures.
+/// @tparam A Connectivity of chosen pixels: 4 or 8.
+/// @tparam B Connectivity of non-chosen pixels: 4, 8 or 0 to disable check.
+template<uint32_t Nmax, uint32_t A, uint32_t B>
+struct FreeLevelGenerator
+{
+	static_assert(Nmax <= 62, "Rows with a margin are stored in 64 bits");
+
+	using Record = FigureRecord<Nmax>;
+	using Row = typename Record::Row;
+	using Rows = uint64_t[Nmax + 4]; // Rows with a margin of one pixel on each side.
+
+	/// Directory of the files.
+	std::string directory = ".";
+	/// Memory for the children of a chunk of parents, in bytes.
+	size_t memoryBudget = (size_t)256 << 20;
+	/// Number of records read or written at once by the merge, per run.
+	static constexpr size_t MergeBuffer = 1024;
+
+	struct LevelResult
+	{
+		uint64_t freeCount = 0;
+		uint64_t fixedCount = 0; // Sum of the number of orientations of each free figure.
+		uint32_t runs = 0;       // Number of sorted runs merged, 0 if the file was reused.
+		bool bReused = false;
+	};
+
+	std::string levelPath(uint32_t size) const
+	{
+		return directory + "/free_a" + std::to_string(A) + "_b" + std::to_string(B)
+			+ "_nmax" + std::to_string(Nmax) + "_n" + std::to_string(size) + ".bin";
+	}
+
+	static bool less(Record const& x, Record const& y)
+	{
+		return memcmp(&x, &y, sizeof(Record)) < 0;
+	}
+
+	static bool equal(Record const& x, Record const& y)
+	{
+		return memcmp(&x, &y, sizeof(Record)) == 0;
+	}
+
+	// ============================================================
+	// Symmetries.
+
+	/// Image of a record by one of the 8 symmetries of the square:
+	/// bit 0 mirrors x, bit 1 mirrors y, bit 2 swaps x and y (after mirroring).
+	static Record transform(Record const& record, uint32_t symmetry)
+	{
+		bool bSwap = (symmetry & 4);
+		Record result;
+		memset(&result, 0, sizeof(result));
+		result.size = record.size;
+		result.width = (bSwap ? record.height : record.width);
+		result.height = (bSwap ? record.width : record.height);
+		for (uint32_t y = 0; y < record.height; ++y) {
+			for (uint32_t x = 0; x < record.width; ++x) {
+				if (not record.get(x, y))
+					continue;
+				uint32_t tx = (symmetry & 1 ? record.width - 1 - x : x);
+				uint32_t ty = (symmetry & 2 ? record.height - 1 - y : y);
+				if (bSwap)
+					result.rows[tx] |= (Row)1 << ty;
+				else
+					result.rows[ty] |= (Row)1 << tx;
+			}
+		}
+		return result;
+	}
+
+	/// Smallest image of a record by the symmetries of the square.
+	/// @param orientations Set to the number of distinct images, which divides 8.
+	static Record canonical(Record const& record, uint32_t& orientations)
+	{
+		Record images[8];
+		uint32_t best = 0;
+		for (uint32_t s = 0; s < 8; ++s) {
+			images[s] = transform(record, s);
+			if (less(images[s], images[best]))
+				best = s;
+		}
+		uint32_t stabilizer = 0;
+		for (uint32_t s = 0; s < 8; ++s)
+			stabilizer += equal(images[s], images[best]);
+		orientations = 8 / stabilizer;
+		return images[best];
+	}
+
+	// ============================================================
+	// Children.
+
+	/// Rows of a record, shifted by one pixel right and up, with empty rows around.
+	static void toRows(Record const& record, Rows& rows)
+	{
+		memset(rows, 0, sizeof(Rows));
+		for (uint32_t y = 0; y < record.height; ++y)
+			rows[y + 1] = (uint64_t)record.rows[y] << 1;
+	}
+
+	/// Pixels connected to 'rows' by 4 or 8 connectivity, including 'rows'.
+	/// Row y of the result depends on rows y - 1 to y + 1, for y in [1, height].
+	template<uint32_t Connectivity>
+	static uint64_t dilateRow(uint64_t const* rows, uint32_t y)
+	{
+		uint64_t row = rows[y];
+		if constexpr (Connectivity == 4) {
+			return row | (row << 1) | (row >> 1) | rows[y - 1] | rows[y + 1];
+		}
+		else {
+			uint64_t around = rows[y - 1] | row | rows[y + 1];
+			return around | (around << 1) | (around >> 1);
+		}
+	}
+
+	/// Whether non-chosen pixels are B-connected, in the bounding box with a margin of one pixel.
+	/// 'rows' has the figure shifted by one pixel right and up, as given by toRows().
+	static bool isValid(Rows const& rows, uint32_t width, uint32_t height)
+	{
+		if constexpr (B == 0) {
+			return true;
+		}
+		else {
+			// White pixels, and the pixels reached from the corner, with empty rows around.
+			uint64_t frame = ((uint64_t)1 << (width + 2)) - 1;
+			uint64_t white[Nmax + 4] = {};
+			uint64_t reached[Nmax + 4] = {};
+			for (uint32_t y = 1; y <= height + 2; ++y)
+				white[y] = ~rows[y - 1] & frame;
+			reached[1] = 1;
+			bool bChanged = true;
+			while (bChanged) {
+				bChanged = false;
+				for (uint32_t y = 1; y <= height + 2; ++y) {
+					uint64_t next = dilateRow<B>(reached, y) & white[y];
+					bChanged |= (next != reached[y]);
+					reached[y] = next;
+				}
+			}
+			for (uint32_t y = 1; y <= height + 2; ++y)
+				if (reached[y] != white[y])
+					return false;
+			return true;
+		}
+	}
+
+	/// Whether chosen pixels are A-connected.
+	/// 'rows' has the figure shifted by one pixel right and up, as given by toRows().
+	static bool isConnected(Rows const& rows, uint32_t height)
+	{
+		uint64_t reached[Nmax + 4] = {};
+		for (uint32_t y = 1; y <= height; ++y) {
+			if (rows[y]) {
+				reached[y] = rows[y] & (~rows[y] + 1);
+				break;
+			}
+		}
+		bool bChanged = true;
+		while (bChanged) {
+			bChanged = false;
+			for (uint32_t y = 1; y <= height; ++y) {
+				uint64_t next = dilateRow<A>(reached, y) & rows[y];
+				bChanged |= (next != reached[y]);
+				reached[y] = next;
+			}
+		}
+		for (uint32_t y = 1; y <= height; ++y)
+			if (reached[y] != rows[y])
+				return false;
+		return true;
+	}
+
+	/// Calls func(child) for each valid child of a record, not canonicalized,
+	/// some children may be given several times.
+	template<typename Func>
+	static void forEachChild(Record const& record, Func&& func)
+	{
+		Rows rows;
+		toRows(record, rows);
+		uint32_t width = record.width, height = record.height;
+		for (uint32_t y = 0; y <= height + 1; ++y) {
+			// Neighbours of chosen pixels, as dilateRow(), the row below the margin being empty.
+			uint64_t below = (y == 0 ? 0 : rows[y - 1]);
+			uint64_t candidates;
+			if constexpr (A == 4) {
+				candidates = (rows[y] << 1) | (rows[y] >> 1) | below | rows[y + 1];
+			}
+			else {
+				uint64_t around = below | rows[y] | rows[y + 1];
+				candidates = around | (around << 1) | (around >> 1);
+			}
+			candidates &= ~rows[y];
+			while (candidates) {
+				uint32_t x = countTrailingZeros(candidates);
+				candidates &= candidates - 1;
+
+				// The new pixel may extend the bounding box on any side.
+				uint32_t xmin = (x == 0 ? 0 : 1), ymin = (y == 0 ? 0 : 1);
+				uint32_t childWidth = width + (x == 0) + (x == width + 1);
+				uint32_t childHeight = height + (y == 0) + (y == height + 1);
+				Rows childRows;
+				memset(childRows, 0, sizeof(Rows));
+				for (uint32_t k = 0; k < childHeight; ++k) {
+					uint64_t row = rows[k + ymin] | (k + ymin == y ? (uint64_t)1 << x : 0);
+					childRows[k + 1] = (row >> xmin) << 1;
+				}
+				if (not isValid(childRows, childWidth, childHeight))
+					continue;
+
+				Record child;
+				memset(&child, 0, sizeof(child));
+				child.size = record.size + 1;
+				child.width = childWidth;
+				child.height = childHeight;
+				for (uint32_t k = 0; k < childHeight; ++k)
+					child.rows[k] = (Row)(childRows[k + 1] >> 1);
+				func(child);
+			}
+		}
+	}
+
+	// ============================================================
+	// Levels.
+
+	/// Makes sure the files of sizes 1 to n exist, generating the missing ones.
+	/// @param callbackLevel Called once per size, as callbackLevel(size, levelResult).
+	/// @retval false if a file could not be read or written.
+	template<typename Func>
+	bool generate(BS::thread_pool& pool, uint32_t n, Func&& callbackLevel)
+	{
+		for (uint32_t size = 1; size <= n; ++size) {
+			LevelResult result;
+			std::string path = levelPath(size);
+			if (FILE* file = fopen(path.c_str(), "rb")) {
+				bool bOk = scanLevel(file, result);
+				fclose(file);
+				if (not bOk)
+					return false;
+				result.bReused = true;
+			}
+			else if (size == 1) {
+				Record single;
+				memset(&single, 0, sizeof(single));
+				single.size = single.width = single.height = 1;
+				single.rows[0] = 1;
+				FILE* file = fopen(path.c_str(), "wb");
+				if (file == nullptr || fwrite(&single, sizeof(Record), 1, file) != 1)
+					return false;
+				fclose(file);
+				result.freeCount = result.fixedCount = 1;
+			}
+			else if (not generateLevel(pool, size, result)) {
+				return false;
+			}
+			callbackLevel(size, result);
+		}
+		return true;
+	}
+
+	/// Counts the figures of an existing file.
+	/// @retval false if the file cannot be read, or is not made of whole records.
+	bool scanLevel(FILE* file, LevelResult& result) const
+	{
+		int64_t bytes = fileSize(file);
+		if (bytes < 0 || bytes % sizeof(Record) != 0)
+			return false;
+		std::vector<Record> buffer(MergeBuffer);
+		size_t count;
+		while ((count = fread(buffer.data(), sizeof(Record), MergeBuffer, file)) != 0) {
+			for (size_t k = 0; k < count; ++k) {
+				uint32_t orientations;
+				canonical(buffer[k], orientations);
+				++result.freeCount;
+				result.fixedCount += orientations;
+			}
+		}
+		return (ferror(file) == 0 && result.freeCount * sizeof(Record) == (uint64_t)bytes);
+	}
+
+	/// Generates the file of 'size' from the file of 'size - 1'.
+	bool generateLevel(BS::thread_pool& pool, uint32_t size, LevelResult& result)
+	{
+		FILE* input = fopen(levelPath(size - 1).c_str(), "rb");
+		if (input == nullptr)
+			return false;
+
+		// A figure of size s has at most 2s + 2 neighbours for 4-connectivity, 4s + 4 for 8.
+		size_t maxChildren = (A == 4 ? 2 * size : 4 * size);
+		size_t chunkParents = std::max<size_t>(memoryBudget / (sizeof(Record) * maxChildren), 1);
+		int64_t bytes = fileSize(input);
+		if (bytes < 0 || bytes % sizeof(Record) != 0) {
+			fclose(input);
+			return false;
+		}
+		chunkParents = std::max<size_t>(std::min<size_t>(chunkParents, bytes / sizeof(Record)), 1);
+		std::vector<Record> parents(chunkParents);
+		std::vector<std::string> runPaths;
+		std::mutex childrenMutex;
+		size_t parentCount;
+
+		while ((parentCount = fread(parents.data(), sizeof(Record), chunkParents, input)) != 0) {
+			// Each block of parents gives a sorted vector of canonical children.
+			std::vector<std::vector<Record>> blocks;
+			pool.push_loop(parentCount, [&] (size_t first, size_t last) {
+				std::vector<Record> children;
+				for (size_t i = first; i < last; ++i) {
+					forEachChild(parents[i], [&] (Record const& child) {
+						uint32_t orientations;
+						children.push_back(canonical(child, orientations));
+					});
+				}
+				std::sort(children.begin(), children.end(), less);
+				children.erase(std::unique(children.begin(), children.end(), equal), children.end());
+				std::lock_guard<std::mutex> lock(childrenMutex);
+				blocks.push_back(std::move(children));
+			});
+			pool.wait_for_tasks();
+
+			std::vector<Record> run;
+			for (std::vector<Record> const& block : blocks) {
+				size_t middle = run.size();
+				run.insert(run.end(), block.begin(), block.end());
+				std::inplace_merge(run.begin(), run.begin() + middle, run.end(), less);
+			}
+			run.erase(std::unique(run.begin(), run.end(), equal), run.end());
+
+			std::string runPath = levelPath(size) + ".run" + std::to_string(runPaths.size());
+			FILE* file = fopen(runPath.c_str(), "wb");
+			bool bWritten = (file != nullptr && fwrite(run.data(), sizeof(Record), run.size(), file) == run.size());
+			if (file != nullptr)
+				fclose(file);
+			runPaths.push_back(runPath);
+			if (not bWritten) {
+				fclose(input);
+				for (std::string const& path : runPaths)
+					remove(path.c_str());
+				return false;
+			}
+		}
+		fclose(input);
+
+		result.runs = (uint32_t)runPaths.size();
+		bool bOk = mergeRuns(runPaths, levelPath(size), result);
+		for (std::string const& runPath : runPaths)
+			remove(runPath.c_str());
+		return bOk;
+	}
+
+	/// Merges sorted runs without duplicates. The output is written to a temporary file,
+	/// renamed at the end, so an interrupted run does not leave an incomplete level.
+	bool mergeRuns(std::vector<std::string> const& runPaths, std::string const& path, LevelResult& result)
+	{
+		struct Run
+		{
+			FILE* file;
+			std::vector<Record> buffer;
+			size_t position = 0;
+			size_t count = 0;
+
+			bool refill()
+			{
+				position = 0;
+				count = fread(buffer.data(), sizeof(Record), buffer.size(), file);
+				return count != 0;
+			}
+		};
+		std::vector<Run> runs(runPaths.size());
+		auto funcGreater = [&runs] (size_t x, size_t y) {
+			return less(runs[y].buffer[runs[y].position], runs[x].buffer[runs[x].position]);
+		};
+		std::priority_queue<size_t, std::vector<size_t>, decltype(funcGreater)> heap(funcGreater);
+		bool bOk = true;
+		for (size_t r = 0; r < runs.size(); ++r) {
+			runs[r].file = fopen(runPaths[r].c_str(), "rb");
+			runs[r].buffer.resize(MergeBuffer);
+			if (runs[r].file == nullptr)
+				bOk = false;
+			else if (runs[r].refill())
+				heap.push(r);
+		}
+
+		std::string temporaryPath = path + ".tmp";
+		FILE* output = (bOk ? fopen(temporaryPath.c_str(), "wb") : nullptr);
+		std::vector<Record> outputBuffer;
+		outputBuffer.reserve(MergeBuffer);
+		Record last;
+		bool bFirst = true;
+		while (output != nullptr && not heap.empty()) {
+			size_t r = heap.top();
+			heap.pop();
+			Record const& record = runs[r].buffer[runs[r].position];
+			if (bFirst || not equal(record, last)) {
+				uint32_t orientations;
+				canonical(record, orientations);
+				++result.freeCount;
+				result.fixedCount += orientations;
+				last = record;
+				bFirst = false;
+				outputBuffer.push_back(record);
+				if (outputBuffer.size() == MergeBuffer) {
+					bOk &= (fwrite(outputBuffer.data(), sizeof(Record), MergeBuffer, output) == MergeBuffer);
+					outputBuffer.clear();
+				}
+			}
+			if (++runs[r].position < runs[r].count || runs[r].refill())
+				heap.push(r);
+		}
+		if (output != nullptr) {
+			bOk &= (fwrite(outputBuffer.data(), sizeof(Record), outputBuffer.size(), output) == outputBuffer.size());
+			fclose(output);
+		}
+		for (Run& run : runs)
+			if (run.file != nullptr)
+				fclose(run.file);
+		bOk = bOk && output != nullptr && rename(temporaryPath.c_str(), path.c_str()) == 0;
+		return bOk;
+	}
+};
@@ -0,0 +1,335 @@
+#pragma once
+
+#include "FigureGenerator.hpp"
+#include "BS_thread_pool.hpp"
+#include "ThreadAffinity.hpp"
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Depth of the roots of the tasks of ParallelGenerator, for connectivity A of chosen pixels.
+template<uint32_t A>
+constexpr uint32_t TaskDepth = (A == 4 ? 8 : 6);
+
+/// Splits the enumeration of a FigureGenerator into independent subtrees (tasks),
+/// which are processed by the threads of a pool.
+///
+/// Each worker owns a context object, created by a factory, which is only accessed
+/// by this worker and thus needs no lock. Contexts are reduced one by one at the end.
+///
+/// @tparam FigGenerator Instantiation of FigureGenerator to be used.
+template<typename FigGenerator>
+struct ParallelGenerator
+{
+	/// Size of the figures at the root of each task.
+	uint32_t initialDepth = 0;
+	/// Copies of the generator, each at the root of a subtree.
+	/// Their statistics, if any, only cover their own subtree.
+	std::vector<FigGenerator> tasks;
+	/// Generator used by split(), its statistics cover the figures of size <= depth.
+	FigGenerator prefix;
+	/// Whether to print the number of processed tasks.
+	bool bShowProgress = true;
+	/// Number of random probes per task to estimate the size of its subtree, and dispatch
+	/// the biggest first, see orderLongestFirst(). 0 keeps the enumeration order.
+	uint32_t probesPerTask = 0;
+	uint64_t probesSeed = 0;
+	/// Estimated number of figures in the subtree of each task, filled by orderLongestFirst().
+	std::vector<double> estimates;
+	/// Whether forEachTask() pins its k-th worker to logical CPU k, modulo the number of CPUs.
+	bool bPinThreads = false;
+
+	/// Time spent by a worker of forEachTask(), in seconds.
+	struct WorkerTiming
+	{
+		double busy = 0; // Processing its tasks.
+		double end = 0;  // From the start of forEachTask() to its last task done.
+	};
+	/// Timings of the workers of the last call to forEachTask(), and its duration.
+	std::vector<WorkerTiming> workerTimings;
+	double forEachSeconds = 0;
+	/// Whether generate() records the number of figures and the time of each task.
+	bool bProfileTasks = false;
+
+	struct TaskProfile
+	{
+		uint64_t figures = 0; // Figures of the subtree, without its root.
+		double seconds = 0;
+	};
+	/// Profile of each task, in the order of tasks, filled by generate() if bProfileTasks.
+	std::vector<TaskProfile> taskProfiles;
+
+	ParallelGenerator()
+	{
+		tasks.reserve(40000);
+	}
+
+	/// Iterates figures of size <= depth on the calling thread,
+	/// and stores as tasks the figures of size depth.
+	/// @param callbackNewFigure Called once per figure of size <= depth,
+	///        as callbackNewFigure(generator).
+	/// @param nmax Maximum size to iterate, no task is stored if depth >= nmax.
+	/// @param depth Size of the figures at the root of each task, big enough
+	///        to have many more tasks than threads.
+	template <typename Func>
+	void split(Func&& callbackNewFigure, uint32_t nmax, uint32_t depth)
+	{
+		initialDepth = (depth < nmax ? depth : nmax);
+		tasks.clear();
+
+		FigGenerator& generator = prefix;
+		generator.init();
+		do {
+			callbackNewFigure(generator);
+			if (generator.level == initialDepth - 1 && initialDepth < nmax) {
+				tasks.emplace_back(generator);
+				tasks.back().stats = {};
+			}
+		}
+		while (generator.nextStep(initialDepth));
+	}
+
+	/// Identifies a task by the indices of its chosen candidates, as "0.1.3.6".
+	/// The indices only depend on the connectivity, so the same prefix gives the same task
+	/// in every run, see findTask().
+	std::string taskPrefix(FigGenerator const& task) const
+	{
+		std::string prefix;
+		for (uint32_t level = 0; level < initialDepth; ++level) {
+			if (level != 0)
+				prefix += '.';
+			prefix += std::to_string(task.chosenIndices[level]);
+		}
+		return prefix;
+	}
+
+	/// Number of indices of a prefix given by taskPrefix(), to be given to split().
+	static uint32_t prefixDepth(char const* prefix)
+	{
+		uint32_t depth = 1;
+		for (char const* p = prefix; *p; ++p)
+			depth += (*p == '.');
+		return depth;
+	}
+
+	/// Finds the task having a prefix given by taskPrefix(), after split() with its depth.
+	/// @return Index of the task, or tasks.size() if there is none.
+	size_t findTask(char const* prefix) const
+	{
+		for (size_t i = 0; i < tasks.size(); ++i)
+			if (taskPrefix(tasks[i]) == prefix)
+				return i;
+		return tasks.size();
+	}
+
+	/// Knuth's estimator of the number of figures of size <= nmax in the subtree of 'generator':
+	/// along a random path from its root, the product of the numbers of valid children met
+	/// so far is an unbiased estimate of the number of figures at each level.
+	static double estimateSubtree(FigGenerator generator, uint32_t nmax, std::mt19937_64& rng)
+	{
+		double estimate = 1;
+		double weight = 1;
+		while (generator.level + 1 < nmax && generator.firstChild()) {
+			// Counts the valid children, and picks one of them uniformly.
+			uint32_t validCount = 0;
+			uint32_t chosen = 0;
+			do {
+				if (generator.checkValidity() && rng() % ++validCount == 0)
+					chosen = generator.chosenIndices[generator.level];
+			}
+			while (generator.nextSibling());
+			if (validCount == 0)
+				break;
+			weight *= validCount;
+			estimate += weight;
+
+			// Candidates are added in the same order, so the chosen child is found again.
+			generator.parent();
+			generator.firstChild();
+			while (generator.chosenIndices[generator.level] != chosen)
+				generator.nextSibling();
+		}
+		return estimate;
+	}
+
+	/// Sorts tasks by decreasing estimated subtree size, so the biggest subtrees do not start
+	/// last and threads finish at about the same time. Estimates are computed on the pool,
+	/// with a random generator per task, so the order only depends on 'seed'.
+	/// @param probes Number of random paths per task, their estimates are averaged.
+	void orderLongestFirst(BS::thread_pool& pool, uint32_t nmax, uint32_t probes, uint64_t seed)
+	{
+		estimates.assign(tasks.size(), 0.0);
+		pool.push_loop(tasks.size(), [&] (size_t first, size_t last) {
+			for (size_t i = first; i < last; ++i) {
+				std::mt19937_64 rng(seed + i);
+				double sum = 0;
+				for (uint32_t p = 0; p < probes; ++p)
+					sum += estimateSubtree(tasks[i], nmax, rng);
+				estimates[i] = sum / probes;
+			}
+		});
+		pool.wait_for_tasks();
+
+		std::vector<size_t> order(tasks.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [this] (size_t x, size_t y) {
+			return estimates[x] > estimates[y];
+		});
+		std::vector<FigGenerator> sortedTasks;
+		std::vector<double> sortedEstimates;
+		sortedTasks.reserve(tasks.size());
+		sortedEstimates.reserve(tasks.size());
+		for (size_t i : order) {
+			sortedTasks.push_back(tasks[i]);
+			sortedEstimates.push_back(estimates[i]);
+		}
+		tasks.swap(sortedTasks);
+		estimates.swap(sortedEstimates);
+	}
+
+	/// Shuffles tasks for anytime estimates, see StratifiedEstimator.
+	/// Tasks sharing the same figure of size strataDepth form a stratum. The order starts
+	/// with two random tasks of each stratum, then the remaining tasks of all strata are
+	/// interleaved proportionally to their sizes, each stratum in random order.
+	/// @return Stratum of each task, in the new order.
+	std::vector<uint32_t> orderStratifiedRandom(uint32_t strataDepth, uint64_t seed)
+	{
+		// Tasks are in enumeration order, so strata are contiguous.
+		std::vector<uint32_t> taskStrata(tasks.size());
+		std::vector<std::vector<size_t>> strata;
+		for (size_t i = 0; i < tasks.size(); ++i) {
+			bool bNewStratum = strata.empty();
+			for (uint32_t level = 0; level < strataDepth && not bNewStratum; ++level)
+				bNewStratum = (tasks[i].chosenIndices[level] != tasks[i - 1].chosenIndices[level]);
+			if (bNewStratum)
+				strata.emplace_back();
+			strata.back().push_back(i);
+		}
+
+		std::mt19937_64 rng(seed);
+		std::uniform_real_distribution<double> uniform;
+		std::vector<std::pair<double, size_t>> keys; // (key, stratum), the smallest key first.
+		std::vector<size_t> ranks(strata.size());
+		for (size_t s = 0; s < strata.size(); ++s) {
+			std::vector<size_t>& stratum = strata[s];
+			std::shuffle(stratum.begin(), stratum.end(), rng);
+			for (size_t j = 0; j < stratum.size(); ++j) {
+				double key = (j < 2 ? j + uniform(rng) : 2 + (j + uniform(rng)) / stratum.size());
+				keys.emplace_back(key, s);
+			}
+		}
+		std::sort(keys.begin(), keys.end());
+
+		std::vector<FigGenerator> sortedTasks;
+		sortedTasks.reserve(tasks.size());
+		for (size_t k = 0; k < keys.size(); ++k) {
+			size_t s = keys[k].second;
+			// Keys of a stratum are increasing with j, so tasks are taken in stratum order.
+			sortedTasks.push_back(tasks[strata[s][ranks[s]++]]);
+			taskStrata[k] = (uint32_t)s;
+		}
+		tasks.swap(sortedTasks);
+		return taskStrata;
+	}
+
+	/// Processes all tasks on the pool's threads.
+	/// @param makeContext Called once per worker, as makeContext(), to create its context.
+	/// @param processTask Called once per task, as processTask(context, generator),
+	///        from the worker owning the context.
+	/// @param reduceContext Called once per worker, as reduceContext(context),
+	///        after all its tasks. Calls are serialized by a mutex.
+	template <typename MakeContext, typename ProcessTask, typename Reduce>
+	void forEachTask(BS::thread_pool& pool, MakeContext&& makeContext, ProcessTask&& processTask, Reduce&& reduceContext)
+	{
+		std::atomic<size_t> nextTask{};
+		std::atomic<size_t> tasksProgress{};
+		std::mutex reduceMutex;
+		BS::synced_stream tasksOutput;
+		using Clock = std::chrono::steady_clock;
+		using Seconds = std::chrono::duration<double>;
+		uint32_t threadCount = pool.get_thread_count();
+		uint32_t cpuCount = std::thread::hardware_concurrency();
+		workerTimings.assign(threadCount, {});
+		Clock::time_point start = Clock::now();
+
+		// Tasks are dispatched one by one, so threads finishing early help others.
+		auto worker = [&] (uint32_t workerIndex) {
+			if (bPinThreads)
+				pinCurrentThread(workerIndex % (cpuCount ? cpuCount : 1));
+			WorkerTiming& timing = workerTimings[workerIndex];
+			auto context = makeContext();
+			for (size_t i = nextTask++; i < tasks.size(); i = nextTask++) {
+				Clock::time_point taskStart = Clock::now();
+				processTask(context, tasks[i]);
+				Clock::time_point taskEnd = Clock::now();
+				timing.busy += Seconds(taskEnd - taskStart).count();
+				timing.end = Seconds(taskEnd - start).count();
+				if (bShowProgress) {
+					char buffer[100];
+					snprintf(buffer, 100, "\r%4zu / %zu", ++tasksProgress, tasks.size());
+					tasksOutput.print(buffer);
+				}
+			}
+			std::lock_guard<std::mutex> lock(reduceMutex);
+			reduceContext(context);
+		};
+
+		for (uint32_t t = 0; t < threadCount; ++t)
+			pool.push_task(worker, t);
+		pool.wait_for_tasks();
+		forEachSeconds = Seconds(Clock::now() - start).count();
+		if (bShowProgress)
+			tasksOutput.println();
+	}
+
+	/// Iterates all figures of size <= nmax, on the pool's threads.
+	/// @param depth Size of the figures at the root of each task, see split().
+	/// @param makeContext Called once per worker, as makeContext(), to create its context.
+	/// @param callbackNewFigure Called once per figure, as callbackNewFigure(context, generator),
+	///        from the worker owning the context.
+	/// @param reduceContext Called once per context, as reduceContext(context),
+	///        after all its figures. Calls are serialized by a mutex.
+	template <typename MakeContext, typename Func, typename Reduce>
+	void generate(BS::thread_pool& pool, uint32_t nmax, uint32_t depth,
+		MakeContext&& makeContext, Func&& callbackNewFigure, Reduce&& reduceContext)
+	{
+		// Small figures are iterated by the calling thread, with its own context.
+		{
+			auto context = makeContext();
+			split([&] (FigGenerator const& generator) {
+				callbackNewFigure(context, generator);
+			}, nmax, depth);
+			reduceContext(context);
+		}
+		if (probesPerTask != 0)
+			orderLongestFirst(pool, nmax, probesPerTask, probesSeed);
+
+		uint32_t rootLevel = initialDepth - 1;
+		taskProfiles.assign(bProfileTasks ? tasks.size() : 0, {});
+		forEachTask(pool, makeContext, [&] (auto& context, FigGenerator& generator) {
+			if (bProfileTasks) {
+				auto start = std::chrono::steady_clock::now();
+				uint64_t figures = 0;
+				while (generator.nextStep(nmax, rootLevel)) {
+					callbackNewFigure(context, generator);
+					++figures;
+				}
+				// Tasks are owned by a single worker, no lock is needed.
+				TaskProfile& profile = taskProfiles[&generator - tasks.data()];
+				profile.figures = figures;
+				profile.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+			else {
+				while (generator.nextStep(nmax, rootLevel))
+					callbackNewFigure(context, generator);
+			}
+		}, reduceContext);
+	}
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+
+/// Estimates the final number of figures per level while tasks are still running.
+///
+/// Tasks are grouped in strata (tasks sharing the same small prefix figure), and a random
+/// subset of each stratum is completed. The count of a stratum is estimated by its number
+/// of tasks times the mean count of its completed tasks, which is unbiased as long as
+/// completed tasks are a uniformly random subset: tasks must be added in a random order
+/// fixed beforehand, not in order of completion, since small tasks complete first.
+///
+/// The confidence interval uses the variance of stratified sampling without replacement,
+/// it shrinks to zero when all tasks are completed.
+/// @tparam Nmax Maximum size of the figures.
+template<uint32_t Nmax>
+struct StratifiedEstimator
+{
+	struct Stratum
+	{
+		uint64_t size = 0; // Number of tasks.
+		uint64_t done = 0; // Number of completed tasks.
+		double sum[Nmax] {};
+		double sumSquares[Nmax] {};
+	};
+
+	std::vector<Stratum> strata;
+	double exact[Nmax] {}; // Figures counted outside of tasks.
+
+	/// @param taskStrata Stratum of each task.
+	/// @param exactCounts Number of figures per level, counted outside of tasks.
+	template<typename Count>
+	void init(std::vector<uint32_t> const& taskStrata, Count const* exactCounts)
+	{
+		strata.clear();
+		for (uint32_t stratum : taskStrata) {
+			if (stratum >= strata.size())
+				strata.resize(stratum + 1);
+			++strata[stratum].size;
+		}
+		for (uint32_t level = 0; level < Nmax; ++level)
+			exact[level] = (double)exactCounts[level];
+	}
+
+	/// @param counts Number of figures per level in the subtree of the task.
+	template<typename Count>
+	void addTask(uint32_t stratum, Count const* counts)
+	{
+		Stratum& s = strata[stratum];
+		++s.done;
+		for (uint32_t level = 0; level < Nmax; ++level) {
+			double x = (double)counts[level];
+			s.sum[level] += x;
+			s.sumSquares[level] += x * x;
+		}
+	}
+
+	/// Whether each stratum has enough completed tasks to estimate its variance.
+	bool ready() const
+	{
+		for (Stratum const& s : strata)
+			if (s.done < (s.size < 2 ? s.size : 2))
+				return false;
+		return true;
+	}
+
+	/// Estimate of the final count of a level, and the half-width of its confidence interval.
+	/// @param z Quantile of the normal distribution, 1.96 for 95% confidence.
+	void estimate(uint32_t level, double& value, double& halfWidth, double z = 1.96) const
+	{
+		value = exact[level];
+		double variance = 0;
+		for (Stratum const& s : strata) {
+			if (s.done == 0)
+				continue;
+			double mean = s.sum[level] / s.done;
+			value += s.size * mean;
+			if (s.done >= 2 && s.done < s.size) {
+				double sampleVariance = (s.sumSquares[level] - s.done * mean * mean) / (s.done - 1);
+				double fpc = 1.0 - (double)s.done / s.size;
+				variance += (double)s.size * s.size * fpc * (sampleVariance > 0 ? sampleVariance : 0) / s.done;
+			}
+		}
+		halfWidth = z * sqrt(variance);
+	}
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "FreeLevelGenerator.hpp"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/// Symmetries of the square, up to conjugation, as needed by Burnside's lemma:
+/// free = (fixed + 2 rot90 + rot180 + 2 reflAxis + 2 reflDiag) / 8,
+/// where each term counts fixed figures invariant under this symmetry.
+enum Symmetry : uint32_t
+{
+	SymRot90,
+	SymRot180,
+	SymReflAxis, // Reflection across a vertical axis.
+	SymReflDiag, // Reflection across a diagonal.
+	SymCount,
+};
+
+inline char const* const SymmetryNames[SymCount] = { "rot90", "rot180", "refl_axis", "refl_diag" };
+inline uint32_t const SymmetryWeights[SymCount] = { 2, 1, 2, 2 };
+
+/// Counts figures invariant under a symmetry, which are exponentially fewer than all figures.
+///
+/// The symmetry is applied with a fixed center, or axis, for each possible type of center:
+/// for instance a rotation by 180 degrees may be centered on a pixel, on the middle of an edge
+/// (horizontal or vertical) or on a corner. Pixels are grouped in orbits of the symmetry, and
+/// connected sets of orbits are enumerated as FigureGenerator does on pixels: each set has a
+/// first orbit (its root), and children add a candidate after the last chosen one.
+/// A connected set of orbits may still be a disconnected figure, such as two mirrored arms,
+/// so the connectivity and the validity are checked on the figure, without pruning.
+///
+/// Rotations fix the translation of invariant figures. For reflections, figures can slide
+/// along the axis, so their root is restricted to the first rows along the axis.
+/// @tparam Nmax Maximum size of the figures.
+template<uint32_t Nmax, uint32_t A, uint32_t B>
+struct SymmetricGenerator
+{
+	using Free = FreeLevelGenerator<Nmax, A, B>;
+	using Rows = typename Free::Rows;
+
+	static constexpr int32_t Radius = Nmax + 1;
+	static constexpr int32_t Side = 2 * Radius + 1;
+
+	struct Orbit
+	{
+		uint32_t size;
+		int32_t x[4], y[4];
+		std::vector<uint32_t> neighbours; // Adjacent orbits, by A-connectivity of their pixels.
+	};
+
+	std::vector<Orbit> orbits;
+	std::vector<uint32_t> roots;
+
+	// Enumeration state.
+	uint32_t nmax = 0;
+	uint32_t root = 0;
+	uint32_t cells = 0;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> chosen;
+	std::vector<bool> seen;
+	uint64_t* counts = nullptr;
+
+	/// Adds to counts[size - 1] the number of figures of size <= n invariant under the symmetry,
+	/// up to translation, for all types of center.
+	void count(Symmetry symmetry, uint32_t n, uint64_t* countsPerLevel)
+	{
+		uint32_t variants = (symmetry == SymRot180 ? 4 : symmetry == SymReflDiag ? 1 : 2);
+		for (uint32_t variant = 0; variant < variants; ++variant) {
+			buildOrbits(symmetry, variant, n);
+			nmax = n;
+			counts = countsPerLevel;
+			for (uint32_t r : roots) {
+				if (orbits[r].size > n)
+					continue;
+				root = r;
+				cells = 0;
+				candidates.assign(1, r);
+				seen.assign(orbits.size(), false);
+				seen[r] = true;
+				enumerate(0);
+			}
+		}
+	}
+
+	/// Image of a pixel, for a type of center 'variant'.
+	static void apply(Symmetry symmetry, uint32_t variant, int32_t& x, int32_t& y)
+	{
+		int32_t a = variant & 1, b = variant >> 1;
+		int32_t tx = x, ty = y;
+		switch (symmetry) {
+			case SymRot90:    x = a - ty; y = tx; break;
+			case SymRot180:   x = a - tx; y = b - ty; break;
+			case SymReflAxis: x = a - tx; break;
+			case SymReflDiag: x = ty; y = tx; break;
+			default: break;
+		}
+	}
+
+	/// Whether a pixel is in the region where invariant figures of size <= n are searched,
+	/// and its rank along the axis of a reflection: orbits are ordered by rank, and only orbits
+	/// of the first ranks are roots. Translations along a diagonal move by 2 ranks, so figures
+	/// start at rank 0 or 1.
+	static bool inRegion(Symmetry symmetry, int32_t n, int32_t x, int32_t y, int32_t& rank)
+	{
+		switch (symmetry) {
+			case SymReflAxis:
+				rank = y;
+				return y >= 0 && y < n && x >= -n && x <= n + 1;
+			case SymReflDiag:
+				rank = x + y;
+				return x + y >= 0 && x + y <= 2 * n + 1 && x - y >= -n && x - y <= n;
+			default:
+				rank = 0;
+				return x >= -n && x <= n + 1 && y >= -n && y <= n + 1;
+		}
+	}
+
+	void buildOrbits(Symmetry symmetry, uint32_t variant, uint32_t n)
+	{
+		orbits.clear();
+		roots.clear();
+		std::vector<uint32_t> orbitOf(Side * Side, UINT32_MAX);
+		auto funcIndex = [] (int32_t x, int32_t y) {
+			return (uint32_t)((y + Radius) * Side + (x + Radius));
+		};
+
+		// Pixels in the order of their rank, then row by row.
+		std::vector<std::pair<int32_t, uint32_t>> order;
+		for (int32_t y = -Radius + 1; y < Radius; ++y) {
+			for (int32_t x = -Radius + 1; x < Radius; ++x) {
+				int32_t rank;
+				if (inRegion(symmetry, n, x, y, rank))
+					order.emplace_back(rank, funcIndex(x, y));
+			}
+		}
+		std::stable_sort(order.begin(), order.end(), [] (auto const& p, auto const& q) {
+			return p.first < q.first;
+		});
+
+		for (auto const& [rank, index] : order) {
+			if (orbitOf[index] != UINT32_MAX)
+				continue;
+			Orbit orbit{};
+			int32_t x = (int32_t)(index % Side) - Radius, y = (int32_t)(index / Side) - Radius;
+			do {
+				orbitOf[funcIndex(x, y)] = (uint32_t)orbits.size();
+				orbit.x[orbit.size] = x;
+				orbit.y[orbit.size] = y;
+				++orbit.size;
+				apply(symmetry, variant, x, y);
+			} while (x != orbit.x[0] || y != orbit.y[0]);
+			int32_t rootRanks = (symmetry == SymReflAxis ? 1 : symmetry == SymReflDiag ? 2 : INT32_MAX);
+			if (rank < rootRanks)
+				roots.push_back((uint32_t)orbits.size());
+			orbits.push_back(orbit);
+		}
+
+		// Images of pixels in the region stay in the region, apart from the margin,
+		// where pixels are never part of a figure of size <= n.
+		for (uint32_t o = 0; o < orbits.size(); ++o) {
+			Orbit& orbit = orbits[o];
+			for (uint32_t k = 0; k < orbit.size; ++k) {
+				for (int32_t dy = -1; dy <= 1; ++dy) {
+					for (int32_t dx = -1; dx <= 1; ++dx) {
+						if ((dx == 0 && dy == 0) || (A == 4 && dx != 0 && dy != 0))
+							continue;
+						int32_t x = orbit.x[k] + dx, y = orbit.y[k] + dy;
+						if (x <= -Radius || x >= Radius || y <= -Radius || y >= Radius)
+							continue;
+						uint32_t other = orbitOf[funcIndex(x, y)];
+						if (other == UINT32_MAX || other == o)
+							continue;
+						if (std::find(orbit.neighbours.begin(), orbit.neighbours.end(), other) == orbit.neighbours.end())
+							orbit.neighbours.push_back(other);
+					}
+				}
+			}
+		}
+	}
+
+	/// Chooses each candidate from index 'first', counts the figure if valid,
+	/// and recurses with the neighbours of the chosen orbit as new candidates.
+	void enumerate(uint32_t first)
+	{
+		uint32_t candidateCount = (uint32_t)candidates.size();
+		for (uint32_t idx = first; idx < candidateCount; ++idx) {
+			uint32_t o = candidates[idx];
+			if (cells + orbits[o].size > nmax)
+				continue;
+			cells += orbits[o].size;
+			chosen.push_back(o);
+
+			if (isValid())
+				++counts[cells - 1];
+			for (uint32_t other : orbits[o].neighbours) {
+				if (other > root && not seen[other]) {
+					seen[other] = true;
+					candidates.push_back(other);
+				}
+			}
+			enumerate(idx + 1);
+			for (uint32_t k = candidateCount; k < candidates.size(); ++k)
+				seen[candidates[k]] = false;
+			candidates.resize(candidateCount);
+
+			chosen.pop_back();
+			cells -= orbits[o].size;
+		}
+	}
+
+	/// Whether the chosen orbits form a connected and valid figure.
+	bool isValid() const
+	{
+		int32_t xmin = INT32_MAX, ymin = INT32_MAX, xmax = INT32_MIN, ymax = INT32_MIN;
+		for (uint32_t o : chosen) {
+			for (uint32_t k = 0; k < orbits[o].size; ++k) {
+				xmin = std::min(xmin, orbits[o].x[k]);
+				xmax = std::max(xmax, orbits[o].x[k]);
+				ymin = std::min(ymin, orbits[o].y[k]);
+				ymax = std::max(ymax, orbits[o].y[k]);
+			}
+		}
+		// A connected figure fits in a square of its size, this also bounds the rows.
+		uint32_t width = xmax - xmin + 1, height = ymax - ymin + 1;
+		if (width > cells || height > cells)
+			return false;
+		Rows rows = {};
+		for (uint32_t o : chosen)
+			for (uint32_t k = 0; k < orbits[o].size; ++k)
+				rows[orbits[o].y[k] - ymin + 1] |= (uint64_t)1 << (orbits[o].x[k] - xmin + 1);
+		return Free::isConnected(rows, height) && Free::isValid(rows, width, height);
+	}
+};
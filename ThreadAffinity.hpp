@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef _WIN32
+// The two functions of kernel32 are declared as in <windows.h>, which is not included,
+// so its macros (min, max, near...) do not leak into the files including this one.
+#ifdef _WIN64
+using ThreadAffinityMask = unsigned __int64; // DWORD_PTR
+#else
+using ThreadAffinityMask = unsigned long;    // DWORD_PTR
+#endif
+extern "C" __declspec(dllimport) void* __stdcall GetCurrentThread();
+extern "C" __declspec(dllimport) ThreadAffinityMask __stdcall SetThreadAffinityMask(void* thread, ThreadAffinityMask mask);
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/// Pins the calling thread to a logical CPU.
+/// @retval false if not supported on this platform, or if it failed.
+inline bool pinCurrentThread(uint32_t cpu)
+{
+#ifdef _WIN32
+	return SetThreadAffinityMask(GetCurrentThread(), (ThreadAffinityMask)1 << (cpu % (8 * sizeof(ThreadAffinityMask)))) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % CPU_SETSIZE, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	(void)cpu;
+	return false;
+#endif
+}
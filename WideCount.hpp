@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Unsigned 128-bit counter, as two 64-bit halves since MSVC has no __int128.
+/// Counts of figures pass 2^64 around n = 23 for a = 8.
+///
+/// Figures are counted in 64-bit counters, per worker or per task: incremented one by one,
+/// they cannot overflow in practice (2^64 increments take centuries). They are flushed with
+/// operator+= into WideCount, where sums over workers and tasks are accumulated.
+/// Overflows of WideCount itself are detected, and sticky.
+struct WideCount
+{
+	uint64_t lo = 0;
+	uint64_t hi = 0;
+	bool bOverflow = false;
+
+	WideCount& operator++()
+	{
+		if (++lo == 0)
+			addHigh(1);
+		return *this;
+	}
+
+	WideCount& operator+=(uint64_t x)
+	{
+		lo += x;
+		if (lo < x)
+			addHigh(1);
+		return *this;
+	}
+
+	WideCount& operator+=(WideCount const& other)
+	{
+		*this += other.lo;
+		addHigh(other.hi);
+		bOverflow |= other.bOverflow;
+		return *this;
+	}
+
+	void addHigh(uint64_t x)
+	{
+		hi += x;
+		bOverflow |= (hi < x);
+	}
+
+	/// Division by 2^shift, for shift in [1, 63].
+	WideCount& operator>>=(uint32_t shift)
+	{
+		lo = (lo >> shift) | (hi << (64 - shift));
+		hi >>= shift;
+		return *this;
+	}
+
+	bool operator==(WideCount const& other) const
+	{
+		return lo == other.lo && hi == other.hi && bOverflow == other.bOverflow;
+	}
+	bool operator!=(WideCount const& other) const
+	{
+		return not (*this == other);
+	}
+
+	explicit operator double() const
+	{
+		return hi * 18446744073709551616.0 + lo;
+	}
+
+	/// Writes the decimal representation, null-terminated.
+	/// 'out' must have at least ReprSize bytes.
+	static constexpr uint32_t ReprSize = 40;
+	void repr(char* out) const
+	{
+		// Divides by 10^9 repeatedly, on 32-bit limbs, most significant first.
+		uint32_t limbs[4] = { (uint32_t)(hi >> 32), (uint32_t)hi, (uint32_t)(lo >> 32), (uint32_t)lo };
+		uint32_t chunks[5]; // Groups of 9 digits, least significant first.
+		uint32_t chunkCount = 0;
+		do {
+			uint64_t remainder = 0;
+			for (uint32_t& limb : limbs) {
+				uint64_t value = (remainder << 32) | limb;
+				limb = (uint32_t)(value / 1000'000'000);
+				remainder = value % 1000'000'000;
+			}
+			chunks[chunkCount++] = (uint32_t)remainder;
+		} while (limbs[0] | limbs[1] | limbs[2] | limbs[3]);
+
+		char* p = out;
+		for (uint32_t k = chunkCount; k-- > 0;) {
+			char digits[9];
+			for (uint32_t d = 9; d-- > 0;) {
+				digits[d] = '0' + chunks[k] % 10;
+				chunks[k] /= 10;
+			}
+			// Leading zeros are only skipped in the most significant group.
+			uint32_t first = 0;
+			if (k + 1 == chunkCount)
+				while (first < 8 && digits[first] == '0')
+					++first;
+			for (uint32_t d = first; d < 9; ++d)
+				*p++ = digits[d];
+		}
+		*p = '\0';
+	}
+};
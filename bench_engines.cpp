@@ -0,0 +1,192 @@
+
+// Cross-engine benchmark: runs the historical engines of _obsolete_code_gascom_2022
+// (MartinAlgoSimple and MartinAlgoOpti) and FigureGenerator on identical workloads,
+// checks that their counts per level agree, and prints their throughput side by side.
+// Returns a non-zero code if counts disagree.
+
+#include "FigureGenerator.hpp"
+#include "FigureGeneratorUnrolled.hpp"
+#include "_obsolete_code_gascom_2022/MartinAlgoSimple.hpp"
+#include "_obsolete_code_gascom_2022/MartinAlgoOpti.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+using ullong = unsigned long long;
+
+constexpr uint32_t MaxSize = 32;
+constexpr uint32_t Repeats = 3;
+
+/// Result of one engine on one workload.
+struct EngineResult
+{
+	char const* name = nullptr;
+	bool done = false;
+	ullong counts[MaxSize + 1]; // Indexed by size.
+	double seconds = 0;        // Best of Repeats runs.
+	ullong state_bytesize = 0;
+};
+
+/// Runs 'func' Repeats times, each time from zero counts, and keeps the best time.
+template<typename Func>
+void Measure(EngineResult& res, Func&& func)
+{
+	for (uint32_t r = 0; r < Repeats; ++r) {
+		memset(res.counts, 0, sizeof(res.counts));
+		auto start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		if (r == 0 || elapsed.count() < res.seconds)
+			res.seconds = elapsed.count();
+	}
+	res.done = true;
+}
+
+template<uint32_t N, uint32_t A, uint32_t B>
+EngineResult Run_FigureGenerator()
+{
+	EngineResult res;
+	res.name = "figure_generator";
+	FigureGenerator<N, A, B> generator;
+	Measure(res, [&] {
+		generator.init();
+		generator.generate([&] {
+			++res.counts[generator.level + 1];
+		});
+	});
+	res.state_bytesize = sizeof(generator);
+	return res;
+}
+
+template<uint32_t N, uint32_t A, uint32_t B, uint32_t K>
+EngineResult Run_FigureGeneratorUnrolled()
+{
+	static char const* const Names[] = { "", "unrolled_k1", "unrolled_k2", "unrolled_k3" };
+	static_assert(K < sizeof(Names) / sizeof(Names[0]));
+	EngineResult res;
+	res.name = Names[K];
+	FigureGeneratorUnrolled<N, A, B, K> generator;
+	Measure(res, [&] {
+		generator.init();
+		generator.generate([&] {
+			++res.counts[generator.level + 1];
+		});
+	});
+	res.state_bytesize = sizeof(generator);
+	return res;
+}
+
+template<uint32_t N, uint32_t A, uint32_t B>
+EngineResult Run_MartinAlgoOpti()
+{
+	EngineResult res;
+	res.name = "martin_opti";
+	using Martin = MartinAlgoOpti<N, A, B, (B == 0 ? GridBehaviour::Minimal : GridBehaviour::Accurate)>;
+	Martin martin;
+	Measure(res, [&] {
+		martin.Init();
+		do {
+			++res.counts[martin.level + 1];
+			martin.NextStep();
+		} while (martin.level > 0);
+	});
+	res.state_bytesize = sizeof(martin);
+	return res;
+}
+
+template<uint32_t N, uint32_t A, uint32_t B>
+EngineResult Run_MartinAlgoSimple()
+{
+	EngineResult res;
+	res.name = "martin_simple";
+	// Not implemented for (8,8).
+	if constexpr (A == 8 && B == 8)
+		return res;
+
+	MartinAlgoSimple martin;
+	Measure(res, [&] {
+		martin.Init(N);
+		do {
+			if (martin.level >= N || martin.next_free == martin.candidates.size()) {
+				if (not martin.Pop())
+					break;
+			}
+			else {
+				Coordinate coord = martin.Push(martin.next_free);
+				if ((B == 4 && martin.WouldBreakWhiteLocal4(coord))
+					|| (B == 8 && martin.WouldBreakWhiteLocal8(coord))) {
+					martin.Pop();
+				}
+				else {
+					++res.counts[martin.level];
+					if (A == 4)
+						martin.AddCandidates4(coord);
+					else
+						martin.AddCandidates8(coord);
+				}
+			}
+		} while (martin.level > 0);
+	});
+	// Approximation of the heap memory, the hash map having one node and one bucket per entry.
+	res.state_bytesize = sizeof(martin)
+		+ martin.candidates.capacity() * sizeof(Candidate)
+		+ (martin.k_start.capacity() + martin.chosen.capacity()) * sizeof(unsigned)
+		+ martin.candidate_indices.size() * (sizeof(std::pair<Coordinate, unsigned>) + 2 * sizeof(void*))
+		+ martin.candidate_indices.bucket_count() * sizeof(void*);
+	return res;
+}
+
+/// Runs all engines on figures of size <= N, prints results and compares counts.
+/// @return Whether all engines agree with FigureGenerator.
+template<uint32_t N, uint32_t A, uint32_t B>
+bool RunWorkload()
+{
+	static_assert(N <= MaxSize);
+	EngineResult results[] = {
+		Run_MartinAlgoSimple<N, A, B>(),
+		Run_MartinAlgoOpti<N, A, B>(),
+		Run_FigureGenerator<N, A, B>(),
+		Run_FigureGeneratorUnrolled<N, A, B, 1>(),
+		Run_FigureGeneratorUnrolled<N, A, B, 2>(),
+		Run_FigureGeneratorUnrolled<N, A, B, 3>(),
+	};
+	EngineResult const& reference = results[2];
+
+	ullong total = 0;
+	for (uint32_t size = 1; size <= N; ++size)
+		total += reference.counts[size];
+
+	printf("[n%u_a%u_b%u]\n", N, A, B);
+	printf("total_count      = %llu\n", total);
+	bool bAgree = true;
+	for (EngineResult const& res : results) {
+		if (not res.done) {
+			printf("%s = unsupported\n", res.name);
+			continue;
+		}
+		for (uint32_t size = 1; size <= N; ++size) {
+			if (res.counts[size] != reference.counts[size]) {
+				printf("%s_mismatch_%u = %llu # expected %llu\n", res.name, size, res.counts[size], reference.counts[size]);
+				bAgree = false;
+			}
+		}
+		printf("%s_seconds = %f\n", res.name, res.seconds);
+		printf("%s_millions_per_sec = %f\n", res.name, (total / 1000'000.0) / res.seconds);
+		printf("%s_state_bytesize = %llu\n", res.name, res.state_bytesize);
+		printf("%s_speedup = %.2f # relative to figure_generator\n", res.name, reference.seconds / res.seconds);
+	}
+	printf("counts_agree     = %s\n\n", bAgree ? "true" : "false");
+	return bAgree;
+}
+
+int main()
+{
+	bool bAgree = true;
+	bAgree &= RunWorkload<12, 4, 0>();
+	bAgree &= RunWorkload<12, 4, 8>();
+	bAgree &= RunWorkload<12, 4, 4>();
+	bAgree &= RunWorkload<9, 8, 0>();
+	bAgree &= RunWorkload<9, 8, 8>();
+	bAgree &= RunWorkload<9, 8, 4>();
+	return bAgree ? 0 : 1;
+}
@@ -1,9 +1,32 @@
 
 #include "FigureGenerator.hpp"
+#include "FigureGeneratorMasked.hpp"
+#include "FigureGeneratorUnrolled.hpp"
+#include "ParallelGenerator.hpp"
+#include "FigurePipeline.hpp"
+#include "FigureRecord.hpp"
+#include "FigureSampler.hpp"
+#include "FigureExtremal.hpp"
+#include "FigureCollection.hpp"
+#include "FigureColumns.hpp"
+#include "FigureRenderer.hpp"
+#include "FigureContour.hpp"
+#include "FigureTree.hpp"
+#include "FreeLevelGenerator.hpp"
+#include "SymmetricGenerator.hpp"
+#include "StratifiedEstimator.hpp"
+#include "WideCount.hpp"
 #include "BS_thread_pool.hpp"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <random>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 
@@ -13,19 +36,116 @@
 
 using ullong = unsigned long long;
 
+// Modes storing figures encode them as FigureRecord, whose rows have at most 64 pixels:
+// they are only compiled for NMAX <= 64, counting supports any NMAX.
+constexpr bool bRecords = (NMAX <= 64);
+// Free and symmetric figures are checked by FreeLevelGenerator, with rows of 64 bits including
+// a margin of one pixel on each side: --free and --burnside are only compiled for NMAX <= 62.
+constexpr bool bFreeFigures = (NMAX <= 62);
+
 struct Result
 {
 	bool done = false;
 	int a, b;
-	ullong counts[NMAX];
+	WideCount counts[NMAX]; // Sums of the 64-bit counters of workers or tasks.
 	ullong time_ms;
 	ullong state_bytesize;
 	FigureGeneratorStats stats;
+	// Only for sampled statistics: half-widths of the 95% confidence intervals
+	// of stats.nonLeaf, stats.leaf and stats.rejected.
+	double statsErrors[3];
+	// Only for perimeter-bounded enumeration: counts[perimeter][level].
+	ullong perimeterCounts[4 * NMAX + 1][NMAX];
+	// Only for sampling: uniformly random figures of each level.
+	std::vector<FigureRecord<NMAX>> samples[NMAX];
+	// Only for extremal figures.
+	FigureExtremal<NMAX> extremal;
+	// Only for task profiling: the slowest tasks, slowest first.
+	struct HeavyTask
+	{
+		std::string prefix;
+		FigureRecord<NMAX> root;
+		ullong figures;
+		ullong rejected; // Only with statistics.
+		double seconds;
+	};
+	std::vector<HeavyTask> heavyTasks;
+	// Only for Burnside's lemma: counts of figures invariant under each symmetry, per level.
+	bool bBurnside = false;
+	uint64_t symmetricCounts[SymCount][NMAX];
+	ullong burnside_ms;
 };
 
+/// Command line options.
+struct Options
+{
+	uint32_t n = 0;
+	uint32_t perimeter = 0;
+	bool stat = false;
+	bool alt = false;
+	bool mt = false;
+	bool masked = false;
+	uint32_t unrolled = 0;  // Number of levels of the unrolled kernel, 0 if disabled.
+	uint32_t pipeline = 0; // Number of consumer threads, 0 if disabled.
+	uint32_t sample = 0;   // Number of random figures per level, 0 if disabled.
+	uint32_t extremal = 0; // Number of extremal figures per statistic, 0 if disabled.
+	uint32_t probes = 0;   // Number of probes per task to order them longest first, 0 if disabled.
+	uint32_t anytime = 0;  // Number of estimates printed during the run, 0 if disabled.
+	double statSample = 0; // Fraction of tasks measured for sampled statistics, 0 if disabled.
+	uint32_t bench = 0;    // Number of benchmark repeats, 0 if disabled.
+	uint32_t scaling = 0;  // Maximum number of threads of the scaling benchmark, 0 if disabled.
+	bool pin = false;      // Whether to pin worker threads to CPUs.
+	uint32_t heavyTasks = 0;            // Number of slowest tasks to print, 0 if disabled.
+	bool collect = false;               // Whether to collect figures of the maximum size.
+	char const* freeDirectory = nullptr; // Directory of the files of free figures, see FreeLevelGenerator.
+	uint32_t freeMemory = 256;          // Memory for the children of a chunk of free figures, in MB.
+	bool burnside = false;              // Whether to count free figures from symmetric figures.
+	char const* columns = nullptr;      // Prefix of the column files, see FigureColumnWriter.
+	char const* render = nullptr;       // Prefix of the file of rendered figures, see FigureRenderer.
+	uint32_t renderFormat = 0;          // FigureRenderer::Format.
+	char const* tree = nullptr;         // Prefix of the file of the enumeration tree, see FigureTreeWriter.
+	char const* replayTask = nullptr;   // Prefix of the task to replay, see ParallelGenerator::taskPrefix().
+	uint64_t seed = 0;
+};
+
+/// Connectivities selected on the command line.
+enum { AB40 = 1, AB48 = 2, AB44 = 4, AB80 = 8, AB88 = 16, AB84 = 32 };
+
+template<uint32_t V>
+using Conn = std::integral_constant<uint32_t, V>;
+
+/// Calls func(a, b) for each connectivity selected in 'ab', with a and b as std::integral_constant,
+/// so func can instantiate MainFunc_Xxxxx<a, b>. Returns false if any call returned false.
+/// @tparam bEnabled Whether the mode is supported by this NMAX, else func is not instantiated.
+template<bool bEnabled = true, typename Func>
+bool ForEachConnectivity(unsigned ab, Func&& func)
+{
+	bool bOk = true;
+	if constexpr (bEnabled) {
+		if (ab & AB40) bOk &= func(Conn<4>(), Conn<0>());
+		if (ab & AB48) bOk &= func(Conn<4>(), Conn<8>());
+		if (ab & AB44) bOk &= func(Conn<4>(), Conn<4>());
+		if (ab & AB80) bOk &= func(Conn<8>(), Conn<0>());
+		if (ab & AB88) bOk &= func(Conn<8>(), Conn<8>());
+		if (ab & AB84) bOk &= func(Conn<8>(), Conn<4>());
+	}
+	return bOk;
+}
+
+/// Applies --pin and --longest-first to the ParallelGenerator of a mode printing its own results,
+/// which does not show progress.
+template<typename FigGenerator>
+void SetParallelOptions(ParallelGenerator<FigGenerator>& parallel, Options const& opt)
+{
+	parallel.bShowProgress = false;
+	parallel.bPinThreads = opt.pin;
+	parallel.probesPerTask = opt.probes;
+	parallel.probesSeed = opt.seed;
+}
+
 /// Function to dispatch to MainFunc_Xxxxx
 template<uint32_t A, uint32_t B, bool bStats>
-Result MainFunc(uint32_t n, bool bAlternative, bool bMultithreaded);
+Result MainFunc(Options const& opt);
 
 /// Implementation using FigureGenerator::generate().
 template<uint32_t A, uint32_t B, bool bStats>
@@ -35,27 +155,90 @@ Result MainFunc_Simple(uint32_t n);
 template<uint32_t A, uint32_t B, bool bStats>
 Result MainFunc_Alternative(uint32_t n);
 
+/// Implementation using FigureGeneratorMasked::generate().
+template<uint32_t A, uint32_t B, bool bStats>
+Result MainFunc_Masked(uint32_t n);
+
+/// Implementation using FigureGeneratorUnrolled::generate().
+template<uint32_t A, uint32_t B, uint32_t K>
+Result MainFunc_Unrolled(uint32_t n);
+
 /// Implementation using FigureGenerator::nextStep() and multithreading.
+/// @tparam bShape Whether to track extremal figures.
+template<uint32_t A, uint32_t B, bool bStats, bool bShape>
+Result MainFunc_Multithreaded(Options const& opt);
+
+/// Implementation using multithreading, with tasks in random order,
+/// printing estimates of the final counts during the run.
+template<uint32_t A, uint32_t B>
+Result MainFunc_Anytime(Options const& opt);
+
+/// Implementation iterating the subtree of a single task of MainFunc_Multithreaded.
+template<uint32_t A, uint32_t B, bool bStats>
+Result MainFunc_ReplayTask(Options const& opt);
+
+/// Implementation using multithreading, measuring statistics on a random sample of tasks.
+template<uint32_t A, uint32_t B>
+Result MainFunc_SampledStats(Options const& opt);
+
+/// Benchmark on a frozen set of subtrees with a fixed budget of figures, printing its own results.
+template<uint32_t A, uint32_t B>
+bool MainFunc_Bench(uint32_t repeats);
+
+/// Benchmark of MainFunc_Multithreaded's workload with 1, 2, 4... threads, printing CSV lines.
+template<uint32_t A, uint32_t B>
+void MainFunc_Scaling(Options const& opt);
+
+/// Collects all figures of size n in memory, with multithreading, printing its own results.
+template<uint32_t A, uint32_t B>
+void MainFunc_Collect(Options const& opt);
+
+/// Writes all figures to column files, with multithreading, printing its own results.
+template<uint32_t A, uint32_t B>
+bool MainFunc_Columns(Options const& opt);
+
+/// Renders all figures of size n, or their contours, to a file, with multithreading, printing its own results.
+template<uint32_t A, uint32_t B>
+bool MainFunc_Render(Options const& opt);
+
+/// Writes the enumeration tree to a file, with multithreading, printing its own results.
+template<uint32_t A, uint32_t B>
+bool MainFunc_Tree(Options const& opt);
+
+/// Generation of free figures level by level, with files, printing its own results.
 template<uint32_t A, uint32_t B>
-Result MainFunc_Multithreaded(uint32_t n);
+bool MainFunc_Free(Options const& opt);
 
+/// Counts symmetric figures with SymmetricGenerator, for free counts by Burnside's lemma.
+template<uint32_t A, uint32_t B>
+void MainFunc_Burnside(Result& res, uint32_t n);
+
+/// Implementation using FigureGenerator::generateBoundedPerimeter().
+template<uint32_t A, uint32_t B>
+Result MainFunc_Perimeter(uint32_t p);
+
+/// Implementation streaming figures from multithreaded generation to consumer threads.
+template<uint32_t A, uint32_t B>
+Result MainFunc_Pipeline(uint32_t n, uint32_t consumers);
+
+/// Prints the neighbourhood patterns met by the validity check, ranked by occurrences,
+/// and for (8,8) ranked by graph traversals.
+void PrintPatternStats(FigureGeneratorStats const& stats, bool bSlowPath);
 
 int main(int argc, char** argv)
 {
 	// printf("sizeof = %zu (nmax = %d)\n", sizeof(FigureGenerator<NMAX, 8, 8>), NMAX);
 	// return 0;
 
-	enum { AB40 = 1, AB48 = 2, AB44 = 4, AB80 = 8, AB88 = 16, AB84 = 32 };
 	unsigned ab = 0;
-	int n = 0;
-	bool stat = false;
-	bool alt = false;
-	bool mt = false;
+	Options opt;
 
 	for (int i = 1; i < argc; ++i) {
 		char const* p = argv[i];
 		if (p[0] == '-' && p[1] == 'n')
-			n = atoi(p + 2);
+			opt.n = atoi(p + 2);
+		else if (p[0] == '-' && p[1] == 'p')
+			opt.perimeter = atoi(p + 2);
 		else if (strcmp(p, "40") == 0)
 			ab |= AB40;
 		else if (strcmp(p, "48") == 0)
@@ -69,71 +252,333 @@ int main(int argc, char** argv)
 		else if (strcmp(p, "84") == 0)
 			ab |= AB84;
 		else if (strcmp(p, "--stat") == 0)
-			stat = true;
+			opt.stat = true;
 		else if (strcmp(p, "--mt") == 0)
-			mt = true;
+			opt.mt = true;
 		else if (strcmp(p, "--alt") == 0)
-			alt = true;
+			opt.alt = true;
+		else if (strcmp(p, "--masked") == 0)
+			opt.masked = true;
+		else if (strncmp(p, "--unrolled=", 11) == 0)
+			opt.unrolled = atoi(p + 11);
+		else if (strncmp(p, "--pipeline=", 11) == 0)
+			opt.pipeline = atoi(p + 11);
+		else if (strncmp(p, "--sample=", 9) == 0)
+			opt.sample = atoi(p + 9);
+		else if (strncmp(p, "--extremal=", 11) == 0)
+			opt.extremal = atoi(p + 11);
+		else if (strncmp(p, "--longest-first=", 16) == 0)
+			opt.probes = atoi(p + 16);
+		else if (strncmp(p, "--stat-sample=", 14) == 0)
+			opt.statSample = atof(p + 14);
+		else if (strcmp(p, "--bench") == 0)
+			opt.bench = 5;
+		else if (strncmp(p, "--bench=", 8) == 0)
+			opt.bench = atoi(p + 8);
+		else if (strcmp(p, "--scaling") == 0)
+			opt.scaling = std::max(1u, std::thread::hardware_concurrency());
+		else if (strncmp(p, "--scaling=", 10) == 0)
+			opt.scaling = atoi(p + 10);
+		else if (strncmp(p, "--free=", 7) == 0)
+			opt.freeDirectory = p + 7;
+		else if (strncmp(p, "--free-memory=", 14) == 0)
+			opt.freeMemory = atoi(p + 14);
+		else if (strcmp(p, "--collect") == 0)
+			opt.collect = true;
+		else if (strncmp(p, "--columns=", 10) == 0)
+			opt.columns = p + 10;
+		else if (strncmp(p, "--ascii=", 8) == 0 || strncmp(p, "--pbm=", 6) == 0 || strncmp(p, "--chain=", 8) == 0) {
+			if (opt.render) {
+				printf("Options --ascii, --pbm and --chain are exclusive.\n");
+				return 1;
+			}
+			opt.render = strchr(p, '=') + 1;
+			opt.renderFormat = (p[2] == 'a' ? FigureRenderer<NMAX>::FormatText
+				: p[2] == 'p' ? FigureRenderer<NMAX>::FormatPbm : FigureRenderer<NMAX>::FormatChain);
+		}
+		else if (strncmp(p, "--tree=", 7) == 0)
+			opt.tree = p + 7;
+		else if (strcmp(p, "--burnside") == 0)
+			opt.burnside = true;
+		else if (strcmp(p, "--pin") == 0)
+			opt.pin = true;
+		else if (strncmp(p, "--heavy-tasks=", 14) == 0)
+			opt.heavyTasks = atoi(p + 14);
+		else if (strncmp(p, "--replay-task=", 14) == 0)
+			opt.replayTask = p + 14;
+		else if (strncmp(p, "--anytime=", 10) == 0)
+			opt.anytime = atoi(p + 10);
+		else if (strncmp(p, "--seed=", 7) == 0)
+			opt.seed = strtoull(p + 7, nullptr, 10);
 		else {
 			printf("Unrecognized argument: %s\n", p);
 			return 1;
 		}
 	}
 
-	if (n == 0 || n > NMAX || ab == 0) {
+	if (opt.perimeter != 0) {
+		if (opt.n != 0) {
+			printf("Options -n and -p are exclusive.\n");
+			return 1;
+		}
+		// Size of the biggest figures having this perimeter.
+		opt.n = FigureGenerator<NMAX, 4, 4, false, true>::maxArea(opt.perimeter);
+		if (opt.n > NMAX) {
+			printf("Perimeter %u needs figures of size %u, recompile and change NMAX.\n", opt.perimeter, opt.n);
+			return 1;
+		}
+	}
+	if (opt.bench && ab != 0) {
+		bool bOk = ForEachConnectivity(ab, [&] (auto a, auto b) {
+			return MainFunc_Bench<a, b>(opt.bench);
+		});
+		return (bOk ? 0 : 1);
+	}
+	if (opt.n == 0 || opt.n > NMAX || ab == 0) {
 		printf("Usage: %s <conn...> -n8 [--stat] [--mt]\n", argv[0]);
 		printf(" conn...: either 40, 44, 48, 80, 84 or 88\n");
 		printf(" -n     : max size of figure, between 1 and %d\n", NMAX);
 		printf("          (for bigger figures, recompile and change NMAX)\n");
+		printf(" -p     : max perimeter of figure, instead of max size\n");
 		printf(" --stat : enable various statistics, lower performances\n");
+		printf("          (with validity check patterns ranked by occurrences)\n");
+		printf(" --stat-sample=0.05 : with --mt, estimate statistics from 5%% of the tasks\n");
 		printf(" --alt  : alternative single thread implementation: nextStep()\n");
+		printf(" --masked : single thread implementation with per-level validity bitmasks\n");
+		printf(" --unrolled=2 : single thread implementation, last 2 levels (1 to 3) unrolled\n");
 		printf(" --mt   : enable multithreaded implementation\n");
+		printf(" --pipeline=4 : multithreaded, figures are streamed to 4 consumer threads\n");
+		printf(" --sample=5   : with --mt, print 5 uniformly random figures per size\n");
+		printf(" --seed=1     : seed of random choices\n");
+		printf(" --extremal=3 : with --mt, print 3 figures with min/max perimeter, bbox area and holes\n");
+		printf(" --longest-first=16 : with --mt, dispatch biggest subtrees first, estimated with 16 probes\n");
+		printf(" --anytime=10 : with --mt, print 10 estimates of the counts during the run\n");
+		printf(" --heavy-tasks=8 : with --mt, print the prefixes of the 8 slowest tasks\n");
+		printf(" --replay-task=0.1.2 : single thread, iterate only the task having this prefix\n");
+		printf(" --bench=5    : benchmark a frozen set of subtrees 5 times, -n is ignored\n");
+		printf(" --scaling=64 : with --mt, CSV of speedup and efficiency with 1, 2, 4... 64 threads\n");
+		printf(" --pin        : with --mt, pin the k-th worker thread to the k-th CPU\n");
+		printf(" --collect    : with --mt, store all figures of size n in one array\n");
+		printf(" --columns=prefix : with --mt, append all figures to one binary file per field, prefix_aA_bB.field.col\n");
+		printf(" --ascii=prefix : with --mt, write all figures of size n as text to prefix_aA_bB.txt\n");
+		printf(" --pbm=prefix : with --mt, write all figures of size n as PBM images to prefix_aA_bB.pbm\n");
+		printf(" --chain=prefix : with --mt, write the contours of figures of size n as chain codes to prefix_aA_bB.chain\n");
+		printf(" --tree=prefix : with --mt, write the enumeration tree, one node per figure, to prefix_aA_bB.tree\n");
+		printf(" --free=dir   : free figures (up to rotations and reflections), one file per size in dir\n");
+		printf(" --free-memory=256 : with --free, MB of children sorted in memory, the rest is merged from files\n");
+		printf(" --burnside   : also count free figures, from the fixed counts and symmetric figures\n");
 		return 1;
 	}
-	if (mt && stat) {
-		printf("Multithreadeding not compatible with statistics.\n");
+	if (opt.mt && opt.alt) {
+		printf("Multithreading not compatible with alternative implementation.\n");
 		return 1;
 	}
-	if (mt && alt) {
-		printf("Multithreading not compatible with alternative implementation.\n");
+	if (opt.masked && (opt.mt || opt.alt || opt.perimeter || opt.pipeline)) {
+		printf("Masked implementation not compatible with other implementations.\n");
+		return 1;
+	}
+	if (opt.unrolled && (opt.unrolled > 3 || opt.stat || opt.mt || opt.alt || opt.masked || opt.perimeter || opt.pipeline)) {
+		printf("Unrolled implementation needs 1 to 3 levels, and is not compatible with other options.\n");
+		return 1;
+	}
+	if (opt.perimeter && (opt.mt || opt.alt || opt.stat)) {
+		printf("Perimeter-bounded enumeration not compatible with other options.\n");
+		return 1;
+	}
+	if (opt.pipeline && (opt.mt || opt.alt || opt.stat || opt.perimeter)) {
+		printf("Pipeline not compatible with other options.\n");
+		return 1;
+	}
+	if ((opt.sample || opt.extremal || opt.probes || opt.anytime || opt.statSample || opt.scaling || opt.pin || opt.heavyTasks || opt.collect || opt.columns || opt.render || opt.tree) && not opt.mt) {
+		printf("Sampling, extremal figures, task ordering, estimates, scaling, profiling, collection and file outputs require multithreading.\n");
+		return 1;
+	}
+	if (opt.anytime && (opt.stat || opt.sample || opt.extremal || opt.probes)) {
+		printf("Estimates not compatible with other options.\n");
+		return 1;
+	}
+	if (opt.statSample && (opt.stat || opt.sample || opt.extremal || opt.probes || opt.anytime || opt.statSample > 1)) {
+		printf("Sampled statistics need a fraction <= 1, and are not compatible with other options.\n");
+		return 1;
+	}
+	if (opt.heavyTasks && (opt.anytime || opt.statSample || opt.scaling)) {
+		printf("Task profiling not compatible with estimates and benchmarks.\n");
+		return 1;
+	}
+	if (opt.replayTask && (opt.mt || opt.alt || opt.masked || opt.perimeter || opt.pipeline)) {
+		printf("Task replay not compatible with other implementations.\n");
+		return 1;
+	}
+	if (opt.scaling && (opt.stat || opt.sample || opt.extremal || opt.anytime || opt.statSample)) {
+		printf("Scaling benchmark not compatible with other options, except --longest-first and --pin.\n");
+		return 1;
+	}
+	if (not bRecords && (opt.sample || opt.extremal || opt.heavyTasks || opt.pipeline || opt.collect || opt.columns || opt.render)) {
+		printf("Sampling, extremal figures, profiling, pipeline, collection and rendering store figures, recompile with NMAX <= 64.\n");
 		return 1;
 	}
+	if (opt.freeDirectory) {
+		if (opt.mt || opt.alt || opt.masked || opt.unrolled || opt.stat || opt.perimeter || opt.pipeline || opt.replayTask) {
+			printf("Free figures not compatible with other options.\n");
+			return 1;
+		}
+		if (not bFreeFigures) {
+			printf("Free figures need rows with a margin, recompile with NMAX <= 62.\n");
+			return 1;
+		}
+		bool bOk = ForEachConnectivity<bFreeFigures>(ab, [&] (auto a, auto b) {
+			return MainFunc_Free<a, b>(opt);
+		});
+		return bOk ? 0 : 1;
+	}
+	if (opt.burnside && (opt.perimeter || opt.anytime || opt.replayTask || opt.freeDirectory || opt.collect || opt.columns || opt.render || opt.tree || opt.scaling)) {
+		printf("Burnside counts need exact fixed counts, not compatible with perimeters, estimates, replay, free, collection and scaling.\n");
+		return 1;
+	}
+	if (opt.burnside && not bFreeFigures) {
+		printf("Burnside counts check symmetric figures with rows with a margin, recompile with NMAX <= 62.\n");
+		return 1;
+	}
+	if (opt.collect && (opt.stat || opt.sample || opt.extremal || opt.anytime || opt.statSample || opt.scaling || opt.heavyTasks)) {
+		printf("Collection not compatible with other options, except --longest-first and --pin.\n");
+		return 1;
+	}
+	if (opt.collect) {
+		ForEachConnectivity<bRecords>(ab, [&] (auto a, auto b) {
+			MainFunc_Collect<a, b>(opt);
+			return true;
+		});
+		return 0;
+	}
+	if (opt.columns && (opt.render || opt.tree || opt.collect || opt.stat || opt.sample || opt.extremal || opt.anytime || opt.statSample || opt.scaling || opt.heavyTasks)) {
+		printf("Column files not compatible with other options, except --longest-first and --pin.\n");
+		return 1;
+	}
+	if (opt.columns) {
+		bool bOk = ForEachConnectivity<bRecords>(ab, [&] (auto a, auto b) {
+			return MainFunc_Columns<a, b>(opt);
+		});
+		return bOk ? 0 : 1;
+	}
+	if (opt.render && (opt.tree || opt.collect || opt.stat || opt.sample || opt.extremal || opt.anytime || opt.statSample || opt.scaling || opt.heavyTasks)) {
+		printf("Rendering not compatible with other options, except --longest-first and --pin.\n");
+		return 1;
+	}
+	if (opt.render) {
+		bool bOk = ForEachConnectivity<bRecords>(ab, [&] (auto a, auto b) {
+			return MainFunc_Render<a, b>(opt);
+		});
+		return bOk ? 0 : 1;
+	}
+	if (opt.tree && (opt.collect || opt.stat || opt.sample || opt.extremal || opt.probes || opt.anytime || opt.statSample || opt.scaling || opt.heavyTasks)) {
+		printf("Tree export not compatible with other options, except --pin.\n");
+		return 1;
+	}
+	if (opt.tree) {
+		bool bOk = ForEachConnectivity(ab, [&] (auto a, auto b) {
+			return MainFunc_Tree<a, b>(opt);
+		});
+		return bOk ? 0 : 1;
+	}
+	if (opt.scaling) {
+		printf("a,b,n,threads,pinned,seconds,speedup,efficiency,parallel_seconds,"
+			"busy_seconds_mean,busy_seconds_max,tail_idle_seconds_mean,tail_idle_seconds_max,utilization\n");
+		ForEachConnectivity(ab, [&] (auto a, auto b) {
+			MainFunc_Scaling<a, b>(opt);
+			return true;
+		});
+		return 0;
+	}
 
+	uint32_t n = opt.n;
+	uint32_t perimeter = opt.perimeter;
+	bool stat = opt.stat;
+	bool alt = opt.alt;
+	bool mt = opt.mt;
 
 	Result res40{}, res44{}, res48{}, res80{}, res84{}, res88{};
 
 	if (stat) {
-		if (ab & AB40) res40 = MainFunc<4, 0, true>(n, alt, mt);
-		if (ab & AB48) res48 = MainFunc<4, 8, true>(n, alt, mt);
-		if (ab & AB44) res44 = MainFunc<4, 4, true>(n, alt, mt);
-		if (ab & AB80) res80 = MainFunc<8, 0, true>(n, alt, mt);
-		if (ab & AB88) res88 = MainFunc<8, 8, true>(n, alt, mt);
-		if (ab & AB84) res84 = MainFunc<8, 4, true>(n, alt, mt);
+		if (ab & AB40) res40 = MainFunc<4, 0, true>(opt);
+		if (ab & AB48) res48 = MainFunc<4, 8, true>(opt);
+		if (ab & AB44) res44 = MainFunc<4, 4, true>(opt);
+		if (ab & AB80) res80 = MainFunc<8, 0, true>(opt);
+		if (ab & AB88) res88 = MainFunc<8, 8, true>(opt);
+		if (ab & AB84) res84 = MainFunc<8, 4, true>(opt);
 	}
 	else {
-		if (ab & AB40) res40 = MainFunc<4, 0, false>(n, alt, mt);
-		if (ab & AB48) res48 = MainFunc<4, 8, false>(n, alt, mt);
-		if (ab & AB44) res44 = MainFunc<4, 4, false>(n, alt, mt);
-		if (ab & AB80) res80 = MainFunc<8, 0, false>(n, alt, mt);
-		if (ab & AB88) res88 = MainFunc<8, 8, false>(n, alt, mt);
-		if (ab & AB84) res84 = MainFunc<8, 4, false>(n, alt, mt);
+		if (ab & AB40) res40 = MainFunc<4, 0, false>(opt);
+		if (ab & AB48) res48 = MainFunc<4, 8, false>(opt);
+		if (ab & AB44) res44 = MainFunc<4, 4, false>(opt);
+		if (ab & AB80) res80 = MainFunc<8, 0, false>(opt);
+		if (ab & AB88) res88 = MainFunc<8, 8, false>(opt);
+		if (ab & AB84) res84 = MainFunc<8, 4, false>(opt);
+	}
+
+	if (opt.burnside) {
+		if (ab & AB40) MainFunc_Burnside<4, 0>(res40, n);
+		if (ab & AB48) MainFunc_Burnside<4, 8>(res48, n);
+		if (ab & AB44) MainFunc_Burnside<4, 4>(res44, n);
+		if (ab & AB80) MainFunc_Burnside<8, 0>(res80, n);
+		if (ab & AB88) MainFunc_Burnside<8, 8>(res88, n);
+		if (ab & AB84) MainFunc_Burnside<8, 4>(res84, n);
 	}
 
+	// Modes give no result after printing an error, such as a replay of an unknown task.
+	bool bOk = true;
+	if (ab & AB40) bOk &= res40.done;
+	if (ab & AB48) bOk &= res48.done;
+	if (ab & AB44) bOk &= res44.done;
+	if (ab & AB80) bOk &= res80.done;
+	if (ab & AB88) bOk &= res88.done;
+	if (ab & AB84) bOk &= res84.done;
+
 	for (Result const & res : { res40, res48, res44, res80, res88, res84 }) {
 		if (not res.done)
 			continue;
 
-		printf("[n%d_a%d_b%d%s%s%s]\n", n, res.a, res.b,
-			(stat ? "_stats" : ""), (alt ? "_alt" : ""), (mt ? "_mt" : ""));
+		if (perimeter)
+			printf("[p%u_a%d_b%d]\n", perimeter, res.a, res.b);
+		else
+			printf("[n%u_a%d_b%d%s%s%s%s%s%s%s%s]\n", n, res.a, res.b,
+				(stat ? "_stats" : opt.statSample ? "_sampled_stats" : ""), (alt ? "_alt" : ""), (mt ? "_mt" : ""),
+				(opt.pipeline ? "_pipeline" : ""), (opt.masked ? "_masked" : ""),
+				(opt.unrolled == 1 ? "_unrolled1" : opt.unrolled == 2 ? "_unrolled2" : opt.unrolled == 3 ? "_unrolled3" : ""),
+				(opt.anytime ? "_anytime" : ""), (opt.replayTask ? "_replay" : ""));
 		printf("time_seconds     = %f\n", res.time_ms / 1000.0);
 		printf("state_bytesize   = %llu\n", res.state_bytesize);
-		ullong total_count = 0;
-		for (int level = 0; level < n; ++level) {
-			total_count += res.counts[level];
-			printf("count_%-10d = %20llu\n", level + 1, res.counts[level]);
+		WideCount total;
+		char repr[WideCount::ReprSize];
+		for (uint32_t level = 0; level < n; ++level) {
+			total += res.counts[level];
+			res.counts[level].repr(repr);
+			printf("count_%-10u = %20s\n", level + 1, repr);
+			if (res.counts[level].bOverflow)
+				printf("# Warning: count_%u overflows 128 bits\n", level + 1);
 		}
-		printf("total_count      = %llu\n", total_count);
+		total.repr(repr);
+		printf("total_count      = %s\n", repr);
+		double total_count = (double)total;
 		printf("millions_per_sec = %f\n", (total_count / 1000'000.0) / (res.time_ms / 1000.0));
+		if (res.bBurnside) {
+			printf("burnside_seconds = %f\n", res.burnside_ms / 1000.0);
+			for (uint32_t level = 0; level < n; ++level) {
+				// free = (fixed + sum of invariant counts, one per symmetry of the square) / 8
+				WideCount sum = res.counts[level];
+				for (uint32_t sym = 0; sym < SymCount; ++sym) {
+					char name[32];
+					snprintf(name, 32, "%s_count_%u", SymmetryNames[sym], level + 1);
+					printf("%-16s = %20llu\n", name, (ullong)res.symmetricCounts[sym][level]);
+					for (uint32_t k = 0; k < SymmetryWeights[sym]; ++k)
+						sum += res.symmetricCounts[sym][level];
+				}
+				if (sum.lo % 8 != 0)
+					printf("# Warning: fixed and symmetric counts of size %u are not consistent\n", level + 1);
+				sum >>= 3;
+				sum.repr(repr);
+				printf("free_count_%-5u = %20s\n", level + 1, repr);
+			}
+		}
 		if (stat) {
 			printf("stat_non_leaf    = %llu\n", res.stats.nonLeaf);
 			printf("stat_leaf        = %llu\n", res.stats.leaf);
@@ -141,23 +586,111 @@ int main(int argc, char** argv)
 			printf("ratio_non_leaf_valid = %5.2f # percent\n", res.stats.nonLeaf * 100.0 / total_count);
 			printf("ratio_leaf_valid     = %5.2f # percent\n", res.stats.leaf * 100.0 / total_count);
 			printf("ratio_rejected_valid = %5.2f # percent\n", res.stats.rejected * 100.0 / total_count);
+			if (res.a == 8 && res.b == 8) {
+				printf("stat_lookup_miss = %llu\n", (ullong)res.stats.lookupMiss);
+				printf("stat_slow_path   = %llu\n", (ullong)res.stats.slowPath);
+				printf("ratio_slow_path_lookup_miss = %5.2f # percent\n", res.stats.slowPath * 100.0 / res.stats.lookupMiss);
+			}
+			if (res.b != 0)
+				PrintPatternStats(res.stats, res.a == 8 && res.b == 8);
+		}
+		if (opt.statSample) {
+			printf("stat_non_leaf    = %llu +- %.0f # 95 percent confidence\n", (ullong)res.stats.nonLeaf, res.statsErrors[0]);
+			printf("stat_leaf        = %llu +- %.0f\n", (ullong)res.stats.leaf, res.statsErrors[1]);
+			printf("stat_rejected	 = %llu +- %.0f\n", (ullong)res.stats.rejected, res.statsErrors[2]);
+			printf("ratio_non_leaf_valid = %5.2f +- %.2f # percent\n", res.stats.nonLeaf * 100.0 / total_count, res.statsErrors[0] * 100.0 / total_count);
+			printf("ratio_leaf_valid     = %5.2f +- %.2f # percent\n", res.stats.leaf * 100.0 / total_count, res.statsErrors[1] * 100.0 / total_count);
+			printf("ratio_rejected_valid = %5.2f +- %.2f # percent\n", res.stats.rejected * 100.0 / total_count, res.statsErrors[2] * 100.0 / total_count);
+		}
+		for (uint32_t level = 0; level < n; ++level) {
+			for (FigureRecord<NMAX> const& record : res.samples[level]) {
+				char repr[FigureRecord<NMAX>::ReprSize];
+				record.repr(repr);
+				printf("sample_%-9u = %s\n", level + 1, repr);
+			}
+		}
+		for (uint32_t level = 0; level < n && res.extremal.k; ++level) {
+			for (uint32_t stat = 0; stat < StatCount; ++stat) {
+				auto const& minimum = res.extremal.minima[level][stat];
+				auto const& maximum = res.extremal.maxima[level][stat];
+				for (auto const* extremum : { &minimum, &maximum }) {
+					char name[48];
+					snprintf(name, 48, "%s_%s_%u", (extremum == &minimum ? "min" : "max"),
+						ExtremalStatNames[stat], level + 1);
+					printf("%-16s = %d\n", name, extremum->value);
+					printf("%s_count = %llu\n", name, (ullong)extremum->multiplicity);
+					for (FigureRecord<NMAX> const& record : extremum->records) {
+						char repr[FigureRecord<NMAX>::ReprSize];
+						record.repr(repr);
+						printf("%s_figure = %s\n", name, repr);
+					}
+				}
+			}
+		}
+		for (size_t k = 0; k < res.heavyTasks.size(); ++k) {
+			Result::HeavyTask const& task = res.heavyTasks[k];
+			char repr[FigureRecord<NMAX>::ReprSize];
+			task.root.repr(repr);
+			char name[32];
+			snprintf(name, 32, "heavy_task_%zu", k + 1);
+			printf("%-16s = %s\n", name, task.prefix.c_str());
+			printf("%s_figure = %s\n", name, repr);
+			printf("%s_figures = %llu\n", name, task.figures);
+			if (stat)
+				printf("%s_rejected = %llu\n", name, task.rejected);
+			printf("%s_seconds = %f\n", name, task.seconds);
+		}
+		if (perimeter) {
+			for (uint32_t p = 4; p <= perimeter; p += 2) {
+				for (uint32_t level = 0; level < n; ++level) {
+					if (res.perimeterCounts[p][level] == 0)
+						continue;
+					char name[32];
+					snprintf(name, 32, "count_p%u_n%u", p, level + 1);
+					printf("%-16s = %20llu\n", name, res.perimeterCounts[p][level]);
+				}
+			}
 		}
 		printf("\n");
 	}
-	return 0;
+	return bOk ? 0 : 1;
 }
 
 
 /// Function to dispatch to MainFunc_Xxxxx
 template<uint32_t A, uint32_t B, bool bStats>
-Result MainFunc(uint32_t n, bool bAlternative, bool bMultithreaded)
+Result MainFunc(Options const& opt)
 {
-	if (bAlternative)
-		return MainFunc_Alternative<A, B, bStats>(n);
-	else if (bMultithreaded)
-		return MainFunc_Multithreaded<A, B>(n);
+	if (opt.perimeter)
+		return MainFunc_Perimeter<A, B>(opt.perimeter);
+	else if (opt.pipeline) {
+		Result res{};
+		if constexpr (bRecords)
+			res = MainFunc_Pipeline<A, B>(opt.n, opt.pipeline);
+		return res;
+	}
+	else if (opt.replayTask)
+		return MainFunc_ReplayTask<A, B, bStats>(opt);
+	else if (opt.alt)
+		return MainFunc_Alternative<A, B, bStats>(opt.n);
+	else if (opt.masked)
+		return MainFunc_Masked<A, B, bStats>(opt.n);
+	else if (opt.unrolled == 1)
+		return MainFunc_Unrolled<A, B, 1>(opt.n);
+	else if (opt.unrolled == 2)
+		return MainFunc_Unrolled<A, B, 2>(opt.n);
+	else if (opt.unrolled == 3)
+		return MainFunc_Unrolled<A, B, 3>(opt.n);
+	else if (opt.mt && opt.statSample)
+		return MainFunc_SampledStats<A, B>(opt);
+	else if (opt.mt && opt.anytime)
+		return MainFunc_Anytime<A, B>(opt);
+	else if (opt.mt && opt.extremal)
+		return MainFunc_Multithreaded<A, B, bStats, true>(opt);
+	else if (opt.mt)
+		return MainFunc_Multithreaded<A, B, bStats, false>(opt);
 	else
-		return MainFunc_Simple<A, B, bStats>(n);
+		return MainFunc_Simple<A, B, bStats>(opt.n);
 }
 
 
@@ -166,7 +699,7 @@ template<uint32_t A, uint32_t B, bool bStats>
 Result MainFunc_Simple(uint32_t n)
 {
 	Result res{};
-	FigureGenerator<NMAX, A, B> generator;
+	FigureGenerator<NMAX, A, B, bStats> generator;
 
 	BS::timer timer;
 	timer.start();
@@ -184,7 +717,7 @@ Result MainFunc_Simple(uint32_t n)
 	res.state_bytesize = sizeof(generator);
 
 	if constexpr (bStats)
-		res.stats = (FigureGeneratorStats&)generator.stats;
+		res.stats = generator.stats;
 
 	return res;
 }
@@ -194,7 +727,7 @@ template<uint32_t A, uint32_t B, bool bStats>
 Result MainFunc_Alternative(uint32_t n)
 {
 	Result res{};
-	FigureGenerator<NMAX, A, B> generator;
+	FigureGenerator<NMAX, A, B, bStats> generator;
 
 	BS::timer timer;
 	timer.start();
@@ -212,81 +745,973 @@ Result MainFunc_Alternative(uint32_t n)
 	res.b = B;
 	res.state_bytesize = sizeof(generator);
 
+	// nextStep() does not count figures of the maximum size, counted as nonLeaf by generate().
+	if constexpr (bStats) {
+		res.stats = generator.stats;
+		res.stats.nonLeaf += res.counts[n - 1].lo; // Statistics are 64-bit.
+	}
+
+	return res;
+}
+
+/// Implementation using FigureGeneratorMasked::generate().
+template<uint32_t A, uint32_t B, bool bStats>
+Result MainFunc_Masked(uint32_t n)
+{
+	Result res{};
+	FigureGeneratorMasked<NMAX, A, B, bStats> generator;
+
+	BS::timer timer;
+	timer.start();
+
+	generator.init();
+	generator.generate([&] {
+		++res.counts[generator.level];
+	}, n);
+
+	timer.stop();
+	res.time_ms = timer.ms();
+	res.done = true;
+	res.a = A;
+	res.b = B;
+	res.state_bytesize = sizeof(generator);
+
 	if constexpr (bStats)
-		res.stats = (FigureGeneratorStats&)generator.stats;
+		res.stats = generator.stats;
+
+	return res;
+}
+
+/// Implementation using FigureGeneratorUnrolled::generate().
+template<uint32_t A, uint32_t B, uint32_t K>
+Result MainFunc_Unrolled(uint32_t n)
+{
+	Result res{};
+	FigureGeneratorUnrolled<NMAX, A, B, K> generator;
+
+	BS::timer timer;
+	timer.start();
+
+	generator.init();
+	generator.generate([&] {
+		++res.counts[generator.level];
+	}, n);
+
+	timer.stop();
+	res.time_ms = timer.ms();
+	res.done = true;
+	res.a = A;
+	res.b = B;
+	res.state_bytesize = sizeof(generator);
 
 	return res;
 }
 
 /// Implementation using FigureGenerator::nextStep() and multithreading.
+/// @tparam bShape Whether to track extremal figures.
+template<uint32_t A, uint32_t B, bool bStats, bool bShape>
+Result MainFunc_Multithreaded(Options const& opt)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B, bStats, bShape>;
+
+	Result res{};
+	ParallelGenerator<FigGenerator> parallel;
+	BS::thread_pool pool;
+	uint32_t n = opt.n;
+	bool bSample = (opt.sample != 0);
+
+	parallel.probesPerTask = opt.probes;
+	parallel.probesSeed = opt.seed;
+	parallel.bPinThreads = opt.pin;
+	parallel.bProfileTasks = (opt.heavyTasks != 0);
+
+	// Each worker counts, samples and tracks extrema on its own, merged at the end.
+	struct Context
+	{
+		ullong counts[NMAX];
+		FigureSampler<NMAX> sampler;
+		StoreIf<bShape, FigureExtremal<NMAX>> extremal;
+	};
+	FigureSampler<NMAX> sampler;
+	std::atomic<uint64_t> workerIndex{};
+	sampler.init(opt.sample, opt.seed);
+	if constexpr (bShape)
+		res.extremal.init(opt.extremal);
+
+	BS::timer timer;
+	timer.start();
+
+	parallel.generate(pool, n, TaskDepth<A>,
+		[&] {
+			Context context{};
+			if (bSample)
+				context.sampler.init(opt.sample, opt.seed + ++workerIndex);
+			if constexpr (bShape)
+				context.extremal.init(opt.extremal);
+			return context;
+		},
+		[bSample] (Context& context, FigGenerator const& generator) {
+			++context.counts[generator.level];
+			if constexpr (bRecords) {
+				if (bSample)
+					context.sampler.offer(generator);
+				if constexpr (bShape)
+					context.extremal.offer(generator);
+			}
+		},
+		[&] (Context& context) {
+			for (uint32_t level = 0; level < n; ++level)
+				res.counts[level] += context.counts[level];
+			if (bSample)
+				sampler.merge(context.sampler);
+			if constexpr (bShape)
+				res.extremal.merge(context.extremal);
+		});
+
+	timer.stop();
+	res.time_ms = timer.ms();
+	res.done = true;
+	res.a = A;
+	res.b = B;
+	res.state_bytesize = sizeof(FigGenerator) * (1 + parallel.tasks.size());
+	for (uint32_t level = 0; level < n; ++level)
+		res.samples[level] = sampler.levels[level].records;
+
+	// Each task has its own statistics, merged at the end.
+	// nextStep() does not count figures of the maximum size, counted as nonLeaf by generate().
+	if constexpr (bStats) {
+		res.stats = parallel.prefix.stats;
+		for (FigGenerator const& task : parallel.tasks)
+			res.stats.merge(task.stats);
+		res.stats.nonLeaf += res.counts[n - 1].lo; // Statistics are 64-bit.
+	}
+
+	// Tasks are ranked by time, their figure and prefix are kept for --replay-task.
+	if (opt.heavyTasks) {
+		std::vector<size_t> order(parallel.taskProfiles.size());
+		std::iota(order.begin(), order.end(), 0);
+		size_t k = std::min<size_t>(opt.heavyTasks, order.size());
+		std::partial_sort(order.begin(), order.begin() + k, order.end(), [&] (size_t x, size_t y) {
+			return parallel.taskProfiles[x].seconds > parallel.taskProfiles[y].seconds;
+		});
+		for (size_t i : std::vector<size_t>(order.begin(), order.begin() + k)) {
+			Result::HeavyTask& task = res.heavyTasks.emplace_back();
+			task.prefix = parallel.taskPrefix(parallel.tasks[i]);
+			if constexpr (bRecords)
+				task.root.assign(parallel.tasks[i]);
+			task.figures = parallel.taskProfiles[i].figures;
+			task.rejected = 0;
+			if constexpr (bStats)
+				task.rejected = parallel.tasks[i].stats.rejected;
+			task.seconds = parallel.taskProfiles[i].seconds;
+		}
+	}
+
+	return res;
+}
+
+/// Implementation iterating the subtree of a single task of MainFunc_Multithreaded,
+/// found again by its prefix, so the hardest subtrees can be profiled in isolation.
+/// Counts only include the figures of the subtree, without its root.
+template<uint32_t A, uint32_t B, bool bStats>
+Result MainFunc_ReplayTask(Options const& opt)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B, bStats>;
+
+	Result res{};
+	ParallelGenerator<FigGenerator> parallel;
+	uint32_t n = opt.n;
+	uint32_t depth = parallel.prefixDepth(opt.replayTask);
+	if (depth >= n) {
+		printf("Task %s has figures of size %u, -n must be bigger.\n", opt.replayTask, depth);
+		return res;
+	}
+	parallel.split([] (FigGenerator const&) {}, n, depth);
+	size_t i = parallel.findTask(opt.replayTask);
+	if (i == parallel.tasks.size()) {
+		printf("No task has prefix %s for (%u,%u).\n", opt.replayTask, A, B);
+		return res;
+	}
+	FigGenerator generator = parallel.tasks[i];
+	uint32_t rootLevel = depth - 1;
+
+	BS::timer timer;
+	timer.start();
+
+	while (generator.nextStep(n, rootLevel))
+		++res.counts[generator.level];
+
+	timer.stop();
+	res.time_ms = timer.ms();
+	res.done = true;
+	res.a = A;
+	res.b = B;
+	res.state_bytesize = sizeof(generator);
+	// nextStep() does not count figures of the maximum size, counted as nonLeaf by generate().
+	if constexpr (bStats) {
+		res.stats = generator.stats;
+		res.stats.nonLeaf += res.counts[n - 1].lo; // Statistics are 64-bit.
+	}
+
+	return res;
+}
+
+/// Implementation using multithreading, with tasks in random order,
+/// printing estimates of the final counts during the run.
 template<uint32_t A, uint32_t B>
-Result MainFunc_Multithreaded(uint32_t n)
+Result MainFunc_Anytime(Options const& opt)
 {
 	using FigGenerator = FigureGenerator<NMAX, A, B>;
 
 	Result res{};
-	FigureGenerator<NMAX, A, B> generator;
+	ParallelGenerator<FigGenerator> parallel;
+	parallel.bShowProgress = false;
 	BS::thread_pool pool;
-	std::mutex resMutex;
-	std::vector<FigGenerator> tasks;
-	std::atomic<size_t> tasksProgress{};
-	BS::synced_stream tasksOutput;
-	tasks.reserve(40000);
+	uint32_t n = opt.n;
 
-	constexpr uint32_t InitialDepth = (A == 4 ? 8 : 6);
+	constexpr uint32_t StrataDepth = TaskDepth<A> - 3;
 
 	BS::timer timer;
 	timer.start();
 
-	generator.init();
-	do {
+	// Small figures are counted exactly.
+	parallel.split([&] (FigGenerator const& generator) {
+		++res.counts[generator.level];
+	}, n, TaskDepth<A>);
+
+	std::vector<uint32_t> taskStrata = parallel.orderStratifiedRandom(StrataDepth, opt.seed);
+	StratifiedEstimator<NMAX> estimator;
+	estimator.init(taskStrata, res.counts);
+
+	// Estimates only use the prefix of the random order where all tasks are completed,
+	// so they do not favour tasks completing early.
+	size_t taskCount = parallel.tasks.size();
+	std::vector<std::array<ullong, NMAX>> taskCounts(taskCount);
+	std::vector<bool> taskDone(taskCount);
+	size_t completedPrefix = 0;
+	uint32_t reportIndex = 1;
+	std::mutex estimateMutex;
+
+	uint32_t rootLevel = parallel.initialDepth - 1;
+	parallel.forEachTask(pool, [] { return 0; }, [&] (int, FigGenerator& generator) {
+		size_t i = &generator - parallel.tasks.data();
+		std::array<ullong, NMAX>& counts = taskCounts[i];
+		while (generator.nextStep(n, rootLevel))
+			++counts[generator.level];
+
+		std::lock_guard<std::mutex> lock(estimateMutex);
+		taskDone[i] = true;
+		while (completedPrefix < taskCount && taskDone[completedPrefix]) {
+			estimator.addTask(taskStrata[completedPrefix], taskCounts[completedPrefix].data());
+			++completedPrefix;
+		}
+		if (completedPrefix * opt.anytime < reportIndex * taskCount || not estimator.ready())
+			return;
+		reportIndex = (uint32_t)(completedPrefix * opt.anytime / taskCount) + 1;
+
+		BS::timer elapsed = timer;
+		elapsed.stop();
+		printf("[n%u_a%d_b%d_estimate]\n", n, A, B);
+		printf("time_seconds     = %f\n", elapsed.ms() / 1000.0);
+		printf("tasks_completed  = %zu / %zu\n", completedPrefix, taskCount);
+		for (uint32_t level = TaskDepth<A>; level < n; ++level) {
+			double value, halfWidth;
+			estimator.estimate(level, value, halfWidth);
+			printf("estimate_%-7u = %20.0f +- %.0f # 95 percent confidence\n", level + 1, value, halfWidth);
+		}
+		printf("\n");
+		fflush(stdout);
+	}, [] (int) {});
+
+	for (std::array<ullong, NMAX> const& counts : taskCounts)
+		for (uint32_t level = 0; level < n; ++level)
+			res.counts[level] += counts[level];
+
+	timer.stop();
+	res.time_ms = timer.ms();
+	res.done = true;
+	res.a = A;
+	res.b = B;
+	res.state_bytesize = sizeof(FigGenerator) * (1 + parallel.tasks.size());
+
+	return res;
+}
+
+/// Implementation using multithreading, measuring statistics on a random sample of tasks.
+template<uint32_t A, uint32_t B>
+Result MainFunc_SampledStats(Options const& opt)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+	using StatsGenerator = FigureGenerator<NMAX, A, B, true>;
+
+	Result res{};
+	ParallelGenerator<FigGenerator> parallel;
+	BS::thread_pool pool;
+	uint32_t n = opt.n;
+
+
+	BS::timer timer;
+	timer.start();
+
+	parallel.split([&] (FigGenerator const& generator) {
 		++res.counts[generator.level];
-		if (generator.level == InitialDepth - 1)
-			tasks.emplace_back(generator);
+	}, n, TaskDepth<A>);
+	double prefixFigures = 0;
+	for (uint32_t level = 0; level < n; ++level)
+		prefixFigures += (double)res.counts[level];
+
+	// Statistics of small figures are measured exactly, as split() does.
+	StatsGenerator prefix;
+	prefix.init();
+	while (prefix.nextStep(parallel.initialDepth)) {}
+
+	// Uniform sample of tasks, without replacement.
+	size_t taskCount = parallel.tasks.size();
+	size_t sampleCount = (size_t)(opt.statSample * taskCount + 0.5);
+	sampleCount = std::min(std::max<size_t>(sampleCount, 2), taskCount);
+	std::vector<size_t> indices(taskCount);
+	std::iota(indices.begin(), indices.end(), 0);
+	std::mt19937_64 rng(opt.seed);
+	std::shuffle(indices.begin(), indices.end(), rng);
+	std::vector<bool> bSampled(taskCount);
+	for (size_t k = 0; k < sampleCount; ++k)
+		bSampled[indices[k]] = true;
+
+	// For sampled tasks: nonLeaf, leaf, rejected and number of figures.
+	std::vector<std::array<double, 4>> taskStats(taskCount);
+
+	struct Context
+	{
+		ullong counts[NMAX];
+	};
+	uint32_t rootLevel = parallel.initialDepth - 1;
+	parallel.forEachTask(pool, [] { return Context{}; }, [&] (Context& context, FigGenerator& generator) {
+		size_t i = &generator - parallel.tasks.data();
+		if (not bSampled[i]) {
+			while (generator.nextStep(n, rootLevel))
+				++context.counts[generator.level];
+			return;
+		}
+		StatsGenerator instrumented;
+		instrumented.assignState(generator);
+		ullong figures = 0;
+		while (instrumented.nextStep(n, rootLevel)) {
+			++context.counts[instrumented.level];
+			++figures;
+		}
+		FigureGeneratorStats const& stats = instrumented.stats;
+		taskStats[i] = { (double)stats.nonLeaf, (double)stats.leaf, (double)stats.rejected, (double)figures };
+	},
+	[&] (Context& context) {
+		for (uint32_t level = 0; level < n; ++level)
+			res.counts[level] += context.counts[level];
+	});
+
+	timer.stop();
+	res.time_ms = timer.ms();
+	res.done = true;
+	res.a = A;
+	res.b = B;
+	res.state_bytesize = sizeof(FigGenerator) * (1 + parallel.tasks.size());
+
+	// Ratio estimator: the number of figures of all tasks is known exactly, and each
+	// statistic is nearly proportional to it, which gives much smaller errors than
+	// scaling by the number of tasks.
+	double taskFigures = -prefixFigures;
+	for (uint32_t level = 0; level < n; ++level)
+		taskFigures += (double)res.counts[level];
+	double sampleSums[4] = {};
+	for (size_t k = 0; k < sampleCount; ++k)
+		for (uint32_t s = 0; s < 4; ++s)
+			sampleSums[s] += taskStats[indices[k]][s];
+
+	double estimates[3] = { (double)prefix.stats.nonLeaf, (double)prefix.stats.leaf, (double)prefix.stats.rejected };
+	for (uint32_t s = 0; s < 3 && sampleCount != 0; ++s) {
+		double ratio = (sampleSums[3] != 0 ? sampleSums[s] / sampleSums[3] : 0);
+		double residualSquares = 0;
+		for (size_t k = 0; k < sampleCount; ++k) {
+			std::array<double, 4> const& x = taskStats[indices[k]];
+			residualSquares += (x[s] - ratio * x[3]) * (x[s] - ratio * x[3]);
+		}
+		double fpc = 1.0 - (double)sampleCount / taskCount;
+		double variance = (sampleCount > 1 ? residualSquares / (sampleCount - 1) : 0);
+		estimates[s] += ratio * taskFigures;
+		res.statsErrors[s] = 1.96 * taskCount * sqrt(fpc * variance / sampleCount);
+	}
+	// nextStep() does not count figures of the maximum size, counted as nonLeaf by generate().
+	res.stats.nonLeaf = (uint64_t)(estimates[0] + 0.5) + res.counts[n - 1].lo;
+	res.stats.leaf = (uint64_t)(estimates[1] + 0.5);
+	res.stats.rejected = (uint64_t)(estimates[2] + 0.5);
+
+	return res;
+}
+
+/// Benchmark on a frozen set of subtrees with a fixed budget of figures, printing its own results.
+/// The subtrees are TaskCount tasks evenly spaced in enumeration order, each iterated up to
+/// size NMAX until it has given its share of the budget, so a run does not depend on -n.
+template<uint32_t A, uint32_t B>
+bool MainFunc_Bench(uint32_t repeats)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+
+	constexpr uint32_t TaskCount = 64;
+	constexpr ullong TaskBudget = 250'000; // Figures per task, 16 millions per run.
+
+	ParallelGenerator<FigGenerator> parallel;
+	parallel.split([] (FigGenerator const&) {}, NMAX, TaskDepth<A>);
+	if (parallel.tasks.empty()) {
+		printf("[bench_n%u_a%u_b%u]\n", NMAX, A, B);
+		printf("# Error: figures of size %u have no subtree, recompile with NMAX > %u\n", NMAX, TaskDepth<A>);
+		printf("\n");
+		return false;
+	}
+	std::vector<FigGenerator> tasks;
+	for (uint32_t k = 0; k < TaskCount; ++k)
+		tasks.push_back(parallel.tasks[k * parallel.tasks.size() / TaskCount]);
+	uint32_t rootLevel = parallel.initialDepth - 1;
+
+	// Nodes of the tree (figures and rejected candidates) are counted once, by an instrumented run.
+	ullong figures = 0;
+	ullong nodes = 0;
+	for (FigGenerator const& task : tasks) {
+		FigureGenerator<NMAX, A, B, true> instrumented;
+		instrumented.assignState(task);
+		ullong taskFigures = 0;
+		while (taskFigures < TaskBudget && instrumented.nextStep(NMAX, rootLevel))
+			++taskFigures;
+		figures += taskFigures;
+		nodes += taskFigures + instrumented.stats.rejected;
+	}
+
+	std::vector<double> seconds;
+	for (uint32_t r = 0; r < repeats; ++r) {
+		auto start = std::chrono::steady_clock::now();
+		ullong runFigures = 0;
+		for (FigGenerator const& task : tasks) {
+			FigGenerator generator = task;
+			ullong taskFigures = 0;
+			while (taskFigures < TaskBudget && generator.nextStep(NMAX, rootLevel))
+				++taskFigures;
+			runFigures += taskFigures;
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		seconds.push_back(elapsed.count());
+		if (runFigures != figures)
+			printf("# Warning: run %u gave %llu figures instead of %llu\n", r, runFigures, figures);
+	}
+	std::sort(seconds.begin(), seconds.end());
+	double median = (seconds[(repeats - 1) / 2] + seconds[repeats / 2]) / 2;
+	double best = seconds[0];
+
+	printf("[bench_n%u_a%u_b%u]\n", NMAX, A, B);
+	printf("tasks            = %u\n", TaskCount);
+	printf("figures          = %llu\n", figures);
+	printf("nodes            = %llu\n", nodes);
+	printf("repeats          = %u\n", repeats);
+	printf("seconds_median   = %f\n", median);
+	printf("seconds_min      = %f\n", best);
+	printf("millions_figures_per_sec_median = %f\n", figures / 1000'000.0 / median);
+	printf("millions_figures_per_sec_best   = %f\n", figures / 1000'000.0 / best);
+	printf("millions_nodes_per_sec_median   = %f\n", nodes / 1000'000.0 / median);
+	printf("millions_nodes_per_sec_best     = %f\n", nodes / 1000'000.0 / best);
+	printf("\n");
+	return true;
+}
+
+/// Benchmark of MainFunc_Multithreaded's workload with 1, 2, 4... threads, printing CSV lines.
+/// Speedup and efficiency are relative to the run with 1 thread, and include the iteration
+/// of the prefix by the calling thread. Busy time is the time spent by a worker in its tasks,
+/// tail idle time is the time between its last task and the end of the slowest worker.
+template<uint32_t A, uint32_t B>
+void MainFunc_Scaling(Options const& opt)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+	using Counts = std::array<ullong, NMAX>;
+
+	uint32_t n = opt.n;
+
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threads = 1; threads < opt.scaling; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(opt.scaling);
+
+	Counts reference{};
+	double baseSeconds = 0;
+	for (uint32_t threads : threadCounts) {
+		ParallelGenerator<FigGenerator> parallel;
+		SetParallelOptions(parallel, opt);
+		BS::thread_pool pool(threads);
+		Counts counts{};
+
+		auto start = std::chrono::steady_clock::now();
+		parallel.generate(pool, n, TaskDepth<A>,
+			[] { return Counts{}; },
+			[] (Counts& context, FigGenerator const& generator) {
+				++context[generator.level];
+			},
+			[&] (Counts& context) {
+				for (uint32_t level = 0; level < n; ++level)
+					counts[level] += context[level];
+			});
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		double seconds = elapsed.count();
+
+		if (threads == 1) {
+			reference = counts;
+			baseSeconds = seconds;
+		}
+		else if (counts != reference) {
+			printf("# Warning: counts with %u threads differ from counts with 1 thread\n", threads);
+		}
+
+		double busyTotal = 0, busyMax = 0, idleTotal = 0, idleMax = 0;
+		for (auto const& timing : parallel.workerTimings) {
+			double idle = parallel.forEachSeconds - timing.end;
+			busyTotal += timing.busy;
+			busyMax = std::max(busyMax, timing.busy);
+			idleTotal += idle;
+			idleMax = std::max(idleMax, idle);
+		}
+		double speedup = baseSeconds / seconds;
+		printf("%u,%u,%u,%u,%d,%f,%f,%f,%f,%f,%f,%f,%f,%f\n", A, B, n, threads, (int)opt.pin,
+			seconds, speedup, speedup / threads, parallel.forEachSeconds,
+			busyTotal / threads, busyMax, idleTotal / threads, idleMax,
+			busyTotal / (threads * parallel.forEachSeconds));
+		fflush(stdout);
+	}
+}
+
+/// Collects all figures of size n in memory, with multithreading, printing its own results.
+/// The memory is reserved before the run, see FigureCollection::expectedCount().
+template<uint32_t A, uint32_t B>
+void MainFunc_Collect(Options const& opt)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+	using Record = FigureRecord<NMAX>;
+	using Counts = std::array<ullong, NMAX>;
+
+	uint32_t n = opt.n;
+	BS::thread_pool pool;
+	uint32_t workers = pool.get_thread_count();
+
+	BS::timer timer;
+	timer.start();
+	Counts counts{};
+	if (n > 1) {
+		ParallelGenerator<FigGenerator> parallel;
+		parallel.bShowProgress = false;
+		parallel.generate(pool, n - 1, TaskDepth<A>,
+			[] { return Counts{}; },
+			[] (Counts& context, FigGenerator const& generator) {
+				++context[generator.level];
+			},
+			[&] (Counts& context) {
+				for (uint32_t level = 0; level < n; ++level)
+					counts[level] += context[level];
+			});
+	}
+	uint64_t expected = FigureCollection<Record>::expectedCount(n, A, counts);
+	timer.stop();
+	double estimateSeconds = timer.ms() / 1000.0;
+
+	FigureCollection<Record> collection;
+	collection.init(expected, workers);
+
+	timer.start();
+	ParallelGenerator<FigGenerator> parallel;
+	SetParallelOptions(parallel, opt);
+	using Arena = typename FigureCollection<Record>::Arena;
+	parallel.generate(pool, n, TaskDepth<A>,
+		[] { return Arena{}; },
+		[&] (Arena& arena, FigGenerator const& generator) {
+			if (generator.level == n - 1)
+				collection.add(arena, generator);
+		},
+		[&] (Arena& arena) {
+			collection.reduce(arena);
+		});
+	collection.finish();
+	timer.stop();
+
+	// Records are in no particular order, so they are hashed independently and summed.
+	ullong checksum = 0;
+	for (Record const& record : collection) {
+		ullong hash = 14695981039346656037ull;
+		for (size_t k = 0; k < sizeof(Record); ++k)
+			hash = (hash ^ ((uint8_t const*)&record)[k]) * 1099511628211ull;
+		checksum += hash;
 	}
-	while (generator.nextStep(InitialDepth));
 
-	pool.push_loop(0, tasks.size(), [&] (size_t imin, size_t imax)
+	printf("[n%u_a%u_b%u_collect]\n", n, A, B);
+	printf("estimate_seconds = %f\n", estimateSeconds);
+	printf("expected_figures = %llu\n", (ullong)expected);
+	printf("memory_estimate_bytesize = %zu\n", collection.memoryEstimate(expected, workers));
+	printf("time_seconds     = %f\n", timer.ms() / 1000.0);
+	printf("figures          = %zu\n", collection.size);
+	printf("spilled_figures  = %zu\n", collection.spilled);
+	printf("memory_bytesize  = %zu\n", collection.capacity * sizeof(Record));
+	printf("record_bytesize  = %zu\n", sizeof(Record));
+	printf("checksum         = %016llx\n", checksum);
+	printf("\n");
+}
+
+template<uint32_t A, uint32_t B>
+bool MainFunc_Columns(Options const& opt)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+	using Writer = FigureColumnWriter<NMAX>;
+
+	uint32_t n = opt.n;
+	char prefix[1024];
+	snprintf(prefix, sizeof(prefix), "%s_a%u_b%u", opt.columns, A, B);
+
+	printf("[n%u_a%u_b%u_columns]\n", n, A, B);
+	Writer writer;
+	if (not writer.open(prefix)) {
+		printf("# Error: cannot open %s.*.col, or they do not match\n", prefix);
+		printf("\n");
+		return false;
+	}
+
+	BS::thread_pool pool;
+	BS::timer timer;
+	timer.start();
+	ParallelGenerator<FigGenerator> parallel;
+	SetParallelOptions(parallel, opt);
+	using Buffer = typename Writer::Buffer;
+	parallel.generate(pool, n, TaskDepth<A>,
+		[&] { return writer.makeBuffer(); },
+		[&] (Buffer& buffer, FigGenerator const& generator) {
+			writer.add(buffer, generator);
+		},
+		[&] (Buffer& buffer) {
+			writer.flush(buffer);
+		});
+	bool bOk = writer.close();
+	timer.stop();
+
+	if (not bOk)
+		printf("# Error: cannot write %s.*.col\n", prefix);
+	printf("time_seconds     = %f\n", timer.ms() / 1000.0);
+	printf("figures          = %llu\n", (ullong)writer.figures);
+	printf("existing_figures = %llu\n", (ullong)writer.existingFigures);
+	uint32_t figureBytesize = 0;
+	for (uint32_t valueSize : Writer::ValueSizes)
+		figureBytesize += valueSize;
+	printf("figure_bytesize  = %u\n", figureBytesize);
+	printf("\n");
+	return bOk;
+}
+
+template<uint32_t A, uint32_t B>
+bool MainFunc_Render(Options const& opt)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+	using Renderer = FigureRenderer<NMAX>;
+	constexpr bool bContour = ((B == 4 || B == 8) && not (A == 8 && B == 8));
+
+	uint32_t n = opt.n;
+	auto format = (typename Renderer::Format)opt.renderFormat;
+	char path[1024];
+	snprintf(path, sizeof(path), "%s_a%u_b%u.%s", opt.render, A, B,
+		(format == Renderer::FormatPbm ? "pbm" : format == Renderer::FormatChain ? "chain" : "txt"));
+
+	printf("[n%u_a%u_b%u_render]\n", n, A, B);
+	if (format == Renderer::FormatChain && not bContour) {
+		printf("# Error: contours need figures without holes (b = 4 or 8), and are not supported for (8,8)\n");
+		printf("\n");
+		return false;
+	}
+	Renderer renderer;
+	if (not renderer.open(path, format)) {
+		printf("# Error: cannot open %s\n", path);
+		printf("\n");
+		return false;
+	}
+
+	BS::thread_pool pool;
+	BS::timer timer;
+	timer.start();
+	ParallelGenerator<FigGenerator> parallel;
+	SetParallelOptions(parallel, opt);
+	using Buffer = typename Renderer::Buffer;
+	parallel.generate(pool, n, TaskDepth<A>,
+		[&] { return renderer.makeBuffer(); },
+		[&] (Buffer& buffer, FigGenerator const& generator) {
+			if (generator.level != n - 1)
+				return;
+			if constexpr (bContour) {
+				if (format == Renderer::FormatChain) {
+					uint8_t codes[FigureContour<NMAX, A, B>::MaxLength];
+					uint32_t length = FigureContour<NMAX, A, B>::trace(generator, codes);
+					renderer.addChain(buffer, codes, length);
+					return;
+				}
+			}
+			renderer.add(buffer, generator);
+		},
+		[&] (Buffer& buffer) {
+			renderer.flush(buffer);
+		});
+	bool bOk = renderer.close();
+	timer.stop();
+
+	if (not bOk)
+		printf("# Error: cannot write %s\n", path);
+	printf("time_seconds     = %f\n", timer.ms() / 1000.0);
+	printf("figures          = %llu\n", (ullong)renderer.figures);
+	printf("bytesize         = %llu\n", (ullong)renderer.bytes);
+	printf("millions_per_sec = %f\n", (renderer.figures / 1000'000.0) / (timer.ms() / 1000.0));
+	printf("\n");
+	return bOk;
+}
+
+template<uint32_t A, uint32_t B>
+bool MainFunc_Tree(Options const& opt)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+	using Writer = FigureTreeWriter<NMAX>;
+	using Arena = typename Writer::Arena;
+
+	uint32_t n = opt.n;
+	char path[1024];
+	snprintf(path, sizeof(path), "%s_a%u_b%u.tree", opt.tree, A, B);
+
+	printf("[n%u_a%u_b%u_tree]\n", n, A, B);
+	Writer writer;
+	if (not writer.open(path, A, B)) {
+		printf("# Error: cannot open %s\n", path);
+		printf("\n");
+		return false;
+	}
+
+	BS::thread_pool pool;
+	BS::timer timer;
+	timer.start();
+	ParallelGenerator<FigGenerator> parallel;
+	SetParallelOptions(parallel, opt);
+
+	// Small figures are written by the calling thread, which gives the ids of the task roots,
+	// in the order of tasks.
+	std::vector<uint64_t> rootIds;
 	{
-        // We are given a block of indices to process for this thread.
-        ullong my_counts[NMAX]{};
-
-        for (size_t i = imin; i < imax; ++i) {
-            auto& generator = tasks[i];
-			while (generator.nextStep(n)) {
-				if (generator.level <= InitialDepth - 1)
-					break;
-				++my_counts[generator.level];
+		Arena arena;
+		uint64_t ids[NMAX];
+		parallel.split([&] (FigGenerator const& generator) {
+			uint32_t level = generator.level;
+			ids[level] = writer.add(arena, generator, (level == 0 ? Writer::NoParent : ids[level - 1]));
+			if (level == parallel.initialDepth - 1 && parallel.initialDepth < n)
+				rootIds.push_back(ids[level]);
+		}, n, TaskDepth<A>);
+		writer.flush(arena);
+	}
+
+	uint32_t rootLevel = parallel.initialDepth - 1;
+	parallel.forEachTask(pool,
+		[] { return Arena(); },
+		[&] (Arena& arena, FigGenerator& generator) {
+			uint64_t ids[NMAX];
+			ids[rootLevel] = rootIds[&generator - parallel.tasks.data()];
+			while (generator.nextStep(n, rootLevel)) {
+				uint32_t level = generator.level;
+				ids[level] = writer.add(arena, generator, ids[level - 1]);
 			}
-			char buffer[100];
-			snprintf(buffer, 100, "\r%4zu / %zu", ++tasksProgress, tasks.size());
-			tasksOutput.print(buffer);
-        }
-        // Merge "my_counts" into "res.counts"
-        resMutex.lock();
-        for (uint32_t level = 0; level < n; ++level)
-			res.counts[level] += my_counts[level];
-        resMutex.unlock();
+		},
+		[&] (Arena& arena) {
+			writer.flush(arena);
+		});
+	bool bOk = writer.close();
+	timer.stop();
+
+	if (not bOk)
+		printf("# Error: cannot write %s\n", path);
+	printf("time_seconds     = %f\n", timer.ms() / 1000.0);
+	printf("nodes            = %llu\n", (ullong)writer.figures);
+	printf("unused_nodes     = %llu\n", (ullong)(writer.nextId - writer.figures));
+	printf("bytesize         = %llu\n", (ullong)(Writer::HeaderSize + writer.nextId * sizeof(typename Writer::Node)));
+	printf("\n");
+	return bOk;
+}
+
+template<uint32_t A, uint32_t B>
+void MainFunc_Burnside(Result& res, uint32_t n)
+{
+	if constexpr (bFreeFigures) {
+		BS::timer timer;
+		timer.start();
+		SymmetricGenerator<NMAX, A, B> generator;
+		for (uint32_t sym = 0; sym < SymCount; ++sym) {
+			for (uint32_t level = 0; level < NMAX; ++level)
+				res.symmetricCounts[sym][level] = 0;
+			generator.count((Symmetry)sym, n, res.symmetricCounts[sym]);
+		}
+		timer.stop();
+		res.burnside_ms = timer.ms();
+		res.bBurnside = true;
+	}
+}
+
+/// Generation of free figures level by level, with files, printing its own results.
+/// fixed_count is the number of figures counted by the other implementations.
+template<uint32_t A, uint32_t B>
+bool MainFunc_Free(Options const& opt)
+{
+	FreeLevelGenerator<NMAX, A, B> generator;
+	generator.directory = opt.freeDirectory;
+	generator.memoryBudget = (size_t)opt.freeMemory << 20;
+	BS::thread_pool pool;
+
+	printf("[n%u_a%u_b%u_free]\n", opt.n, A, B);
+	BS::timer timer;
+	timer.start();
+	BS::timer levelTimer = timer;
+	bool bOk = generator.generate(pool, opt.n, [&] (uint32_t size, auto const& level) {
+		BS::timer elapsed = levelTimer;
+		elapsed.stop();
+		levelTimer.start();
+		printf("free_count_%-5u = %20llu\n", size, (ullong)level.freeCount);
+		printf("fixed_count_%-4u = %20llu\n", size, (ullong)level.fixedCount);
+		printf("seconds_%-8u = %f%s\n", size, elapsed.ms() / 1000.0, (level.bReused ? " # reused" : ""));
+		printf("runs_%-11u = %u\n", size, level.runs);
+		fflush(stdout);
 	});
-	pool.wait_for_tasks();
-	tasksOutput.println();
+	timer.stop();
+	if (not bOk)
+		printf("# Error: cannot read or write the files in %s, or they are not made of whole records\n", opt.freeDirectory);
+	printf("time_seconds     = %f\n", timer.ms() / 1000.0);
+	printf("\n");
+	return bOk;
+}
+
+/// Implementation using FigureGenerator::generateBoundedPerimeter().
+template<uint32_t A, uint32_t B>
+Result MainFunc_Perimeter(uint32_t p)
+{
+	Result res{};
+	FigureGenerator<NMAX, A, B, false, true> generator;
+
+	BS::timer timer;
+	timer.start();
+
+	generator.init();
+	generator.generateBoundedPerimeter([&] {
+		uint32_t level = generator.level;
+		++res.counts[level];
+		++res.perimeterCounts[generator.shapes.shape[level].perimeter][level];
+	}, p);
 
 	timer.stop();
 	res.time_ms = timer.ms();
 	res.done = true;
 	res.a = A;
 	res.b = B;
-	res.state_bytesize = sizeof(generator) * (1 + tasks.size());
+	res.state_bytesize = sizeof(generator);
 
 	return res;
 }
 
+/// Implementation streaming figures from multithreaded generation to consumer threads.
+template<uint32_t A, uint32_t B>
+Result MainFunc_Pipeline(uint32_t n, uint32_t consumers)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+	using Record = FigureRecord<NMAX>;
+	using Pipeline = FigurePipeline<Record>;
+
+	Result res{};
+	ParallelGenerator<FigGenerator> parallel;
+	BS::thread_pool pool;
+	Pipeline pipeline;
+
 
+	// Consumers count figures from the received records, as a stand-in for heavier analysis.
+	std::vector<std::array<ullong, NMAX>> consumerCounts(consumers);
 
+	BS::timer timer;
+	timer.start();
+
+	// One producer per worker, and one for small figures on the calling thread.
+	pipeline.start(pool.get_thread_count() + 1, consumers,
+		[&] (uint32_t consumer, Record const* records, size_t count) {
+			for (size_t i = 0; i < count; ++i)
+				++consumerCounts[consumer][records[i].size - 1];
+		});
+
+	parallel.generate(pool, n, TaskDepth<A>,
+		[&] { return &pipeline.acquireRing(); },
+		[] (typename Pipeline::Ring* ring, FigGenerator const& generator) {
+			ring->pushSlot().assign(generator);
+			ring->commitPush();
+		},
+		[] (typename Pipeline::Ring* ring) {
+			ring->close();
+		});
+	pipeline.finish();
+
+	for (auto const& counts : consumerCounts)
+		for (uint32_t level = 0; level < n; ++level)
+			res.counts[level] += counts[level];
+
+	timer.stop();
+	res.time_ms = timer.ms();
+	res.done = true;
+	res.a = A;
+	res.b = B;
+	res.state_bytesize = sizeof(FigGenerator) * (1 + parallel.tasks.size())
+	                   + sizeof(typename Pipeline::Ring) * pipeline.rings.size();
 
+	return res;
+}
 
 
+void PrintPatternStats(FigureGeneratorStats const& stats, bool bSlowPath)
+{
+	constexpr uint32_t RankedCount = 16;
 
+	// Neighbourhood as "abc/d+f/ghi", '+' being the new pixel.
+	auto funcRepr = [] (uint32_t n, char* out) {
+		constexpr int Cells[11] = { 0, 1, 2, -1, 3, -2, 4, -1, 5, 6, 7 };
+		for (uint32_t k = 0; k < 11; ++k)
+			out[k] = (Cells[k] == -1 ? '/' : Cells[k] == -2 ? '+' : ((n >> Cells[k]) & 1) ? 'X' : '.');
+		out[11] = '\0';
+	};
 
+	ullong occurrences[256];
+	ullong total = 0;
+	uint32_t patterns[256];
+	uint32_t distinct = 0;
+	for (uint32_t n = 0; n < 256; ++n) {
+		occurrences[n] = stats.patternAccepted[n] + stats.patternRejected[n];
+		total += occurrences[n];
+		distinct += (occurrences[n] != 0);
+		patterns[n] = n;
+	}
+	printf("stat_patterns    = %u # distinct neighbourhoods\n", distinct);
 
+	std::stable_sort(patterns, patterns + 256, [&] (uint32_t x, uint32_t y) {
+		return occurrences[x] > occurrences[y];
+	});
+	for (uint32_t rank = 0; rank < RankedCount && occurrences[patterns[rank]] != 0; ++rank) {
+		uint32_t n = patterns[rank];
+		char repr[12];
+		funcRepr(n, repr);
+		printf("stat_pattern_%-3u = %s %12llu # %5.2f percent, rejected %6.2f percent\n", rank + 1, repr,
+			occurrences[n], occurrences[n] * 100.0 / total, stats.patternRejected[n] * 100.0 / occurrences[n]);
+	}
 
+	if (not bSlowPath)
+		return;
+	printf("stat_visited_cells = %llu\n", (ullong)stats.visitedCells);
+	printf("ratio_visited_cells_slow_path = %.1f # pixels per traversal\n",
+		stats.slowPath ? (double)stats.visitedCells / stats.slowPath : 0.0);
+	std::stable_sort(patterns, patterns + 256, [&] (uint32_t x, uint32_t y) {
+		return stats.patternSlowPath[x] > stats.patternSlowPath[y];
+	});
+	for (uint32_t rank = 0; rank < RankedCount && stats.patternSlowPath[patterns[rank]] != 0; ++rank) {
+		uint32_t n = patterns[rank];
+		char repr[12];
+		funcRepr(n, repr);
+		printf("stat_slow_path_pattern_%-3u = %s %12llu # %5.2f percent\n", rank + 1, repr,
+			(ullong)stats.patternSlowPath[n], stats.patternSlowPath[n] * 100.0 / stats.slowPath);
+	}
+}
@@ -0,0 +1,316 @@
+
+// Python extension module 'figuregen', with the plain C API (no pybind11 nor NumPy needed):
+//
+//   figuregen.count(n, a, b, threads=0) -> list of the numbers of figures of size 1 to n
+//   figuregen.figures(n, a, b, threads=0) -> FigureArray of all figures of size n
+//
+// FigureArray exposes the FigureRecord array through the buffer protocol, as bytes of shape
+// (figures, record_size), without copy nor Python object per figure, for instance:
+//   numpy.frombuffer(array, dtype=[('size', 'u1'), ('width', 'u1'), ('height', 'u1'),
+//       ('reserved', 'u1'), ('rows', '<u4', (figuregen.NMAX,))])
+// For NMAX > 32, rows are '<u8', after a ('padding', 'u1', (4,)) field aligning them on 8 bytes.
+// The enumeration runs on 'threads' threads (0 for all CPUs), with the GIL released.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "FigureGenerator.hpp"
+#include "ParallelGenerator.hpp"
+#include "FigureRecord.hpp"
+#include "FigureCollection.hpp"
+#include "WideCount.hpp"
+#include "BS_thread_pool.hpp"
+#include <array>
+#include <memory>
+#include <new>
+
+#ifndef NMAX
+#define NMAX 20
+#endif
+
+using ullong = unsigned long long;
+using Record = FigureRecord<NMAX>;
+using LevelCounts = std::array<ullong, NMAX>; // Per worker.
+using Counts = std::array<WideCount, NMAX>;   // Sums, which pass 2^64 for big n.
+
+/// Counts figures of size <= n.
+template<uint32_t A, uint32_t B>
+Counts CountFigures(uint32_t n, uint32_t threads)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+
+	BS::thread_pool pool(threads);
+	Counts counts{};
+	ParallelGenerator<FigGenerator> parallel;
+	parallel.bShowProgress = false;
+	parallel.generate(pool, n, TaskDepth<A>,
+		[] { return LevelCounts{}; },
+		[] (LevelCounts& context, FigGenerator const& generator) {
+			++context[generator.level];
+		},
+		[&] (LevelCounts& context) {
+			for (uint32_t level = 0; level < n; ++level)
+				counts[level] += context[level];
+		});
+	return counts;
+}
+
+/// Collects figures of size n, in no particular order, as MainFunc_Collect does.
+template<uint32_t A, uint32_t B>
+void CollectFigures(uint32_t n, uint32_t threads, FigureCollection<Record>& collection)
+{
+	using FigGenerator = FigureGenerator<NMAX, A, B>;
+
+	Counts counts{};
+	if (n > 2)
+		counts = CountFigures<A, B>(n - 1, threads);
+
+	BS::thread_pool pool(threads);
+	collection.init(FigureCollection<Record>::expectedCount(n, A, counts), pool.get_thread_count());
+	ParallelGenerator<FigGenerator> parallel;
+	parallel.bShowProgress = false;
+	using Arena = typename FigureCollection<Record>::Arena;
+	parallel.generate(pool, n, TaskDepth<A>,
+		[] { return Arena{}; },
+		[&] (Arena& arena, FigGenerator const& generator) {
+			if (generator.level == n - 1)
+				collection.add(arena, generator);
+		},
+		[&] (Arena& arena) {
+			collection.reduce(arena);
+		});
+	collection.finish();
+}
+
+/// Parses (n, a, b, threads=0), and checks them.
+static bool ParseArguments(PyObject* args, PyObject* kwargs, uint32_t& n, uint32_t& a, uint32_t& b, uint32_t& threads)
+{
+	static char const* keywords[] = { "n", "a", "b", "threads", nullptr };
+	unsigned int pn, pa, pb, pthreads = 0;
+	if (not PyArg_ParseTupleAndKeywords(args, kwargs, "III|I", (char**)keywords, &pn, &pa, &pb, &pthreads))
+		return false;
+	if (pn < 1 || pn > NMAX) {
+		PyErr_Format(PyExc_ValueError, "n must be between 1 and %d", NMAX);
+		return false;
+	}
+	if (not ((pa == 4 || pa == 8) && (pb == 0 || pb == 4 || pb == 8))) {
+		PyErr_SetString(PyExc_ValueError, "a must be 4 or 8, and b must be 0, 4 or 8");
+		return false;
+	}
+	n = pn;
+	a = pa;
+	b = pb;
+	threads = pthreads;
+	return true;
+}
+
+// ============================================================
+// FigureArray
+
+struct FigureArrayObject
+{
+	PyObject_HEAD
+	FigureCollection<Record>* collection;
+	Py_ssize_t shape[2];
+	Py_ssize_t strides[2];
+};
+
+static void FigureArray_dealloc(FigureArrayObject* self)
+{
+	delete self->collection;
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int FigureArray_getbuffer(FigureArrayObject* self, Py_buffer* view, int flags)
+{
+	if (flags & PyBUF_WRITABLE) {
+		PyErr_SetString(PyExc_BufferError, "FigureArray is read-only");
+		view->obj = nullptr;
+		return -1;
+	}
+	view->obj = (PyObject*)self;
+	Py_INCREF(self);
+	view->buf = (void*)self->collection->begin();
+	view->len = self->shape[0] * self->shape[1];
+	view->readonly = 1;
+	view->itemsize = 1;
+	view->format = (flags & PyBUF_FORMAT) ? (char*)"B" : nullptr;
+	view->ndim = 2;
+	view->shape = (flags & PyBUF_ND) ? self->shape : nullptr;
+	view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : nullptr;
+	view->suboffsets = nullptr;
+	view->internal = nullptr;
+	return 0;
+}
+
+static Py_ssize_t FigureArray_length(FigureArrayObject* self)
+{
+	return self->shape[0];
+}
+
+static PyObject* FigureArray_get_record_size(FigureArrayObject*, void*)
+{
+	return PyLong_FromSize_t(sizeof(Record));
+}
+
+static PyBufferProcs FigureArray_bufferProcs = {
+	(getbufferproc)FigureArray_getbuffer,
+	nullptr,
+};
+
+static PySequenceMethods FigureArray_sequenceMethods = {};
+
+static PyGetSetDef FigureArray_getset[] = {
+	{ "record_size", (getter)FigureArray_get_record_size, nullptr, "Bytes per figure.", nullptr },
+	{},
+};
+
+// Static objects are value-initialized and filled by PyInit_figuregen(), as their
+// structures get new members with Python versions.
+static PyTypeObject FigureArrayType = {};
+
+// ============================================================
+// Module functions
+
+/// Python int of a count, from its two 64-bit halves.
+static PyObject* LongFromCount(WideCount const& count)
+{
+	if (count.bOverflow) {
+		PyErr_SetString(PyExc_OverflowError, "count overflows 128 bits");
+		return nullptr;
+	}
+	if (count.hi == 0)
+		return PyLong_FromUnsignedLongLong(count.lo);
+	PyObject* hi = PyLong_FromUnsignedLongLong(count.hi);
+	PyObject* lo = PyLong_FromUnsignedLongLong(count.lo);
+	PyObject* shift = PyLong_FromLong(64);
+	PyObject* high = (hi && shift ? PyNumber_Lshift(hi, shift) : nullptr);
+	PyObject* value = (high && lo ? PyNumber_Or(high, lo) : nullptr);
+	Py_XDECREF(hi);
+	Py_XDECREF(lo);
+	Py_XDECREF(shift);
+	Py_XDECREF(high);
+	return value;
+}
+
+static PyObject* Module_count(PyObject*, PyObject* args, PyObject* kwargs)
+{
+	uint32_t n, a, b, threads;
+	if (not ParseArguments(args, kwargs, n, a, b, threads))
+		return nullptr;
+
+	Counts counts{};
+	bool bNoMemory = false;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		if (a == 4 && b == 0) counts = CountFigures<4, 0>(n, threads);
+		if (a == 4 && b == 8) counts = CountFigures<4, 8>(n, threads);
+		if (a == 4 && b == 4) counts = CountFigures<4, 4>(n, threads);
+		if (a == 8 && b == 0) counts = CountFigures<8, 0>(n, threads);
+		if (a == 8 && b == 8) counts = CountFigures<8, 8>(n, threads);
+		if (a == 8 && b == 4) counts = CountFigures<8, 4>(n, threads);
+	}
+	catch (std::bad_alloc const&) {
+		bNoMemory = true;
+	}
+	Py_END_ALLOW_THREADS
+	if (bNoMemory)
+		return PyErr_NoMemory();
+
+	PyObject* list = PyList_New(n);
+	if (list == nullptr)
+		return nullptr;
+	for (uint32_t level = 0; level < n; ++level) {
+		PyObject* value = LongFromCount(counts[level]);
+		if (value == nullptr) {
+			Py_DECREF(list);
+			return nullptr;
+		}
+		PyList_SET_ITEM(list, level, value);
+	}
+	return list;
+}
+
+static PyObject* Module_figures(PyObject*, PyObject* args, PyObject* kwargs)
+{
+	uint32_t n, a, b, threads;
+	if (not ParseArguments(args, kwargs, n, a, b, threads))
+		return nullptr;
+
+	FigureArrayObject* array = PyObject_New(FigureArrayObject, &FigureArrayType);
+	if (array == nullptr)
+		return nullptr;
+	array->collection = nullptr;
+
+	bool bNoMemory = false;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		std::unique_ptr<FigureCollection<Record>> collection(new FigureCollection<Record>);
+		if (a == 4 && b == 0) CollectFigures<4, 0>(n, threads, *collection);
+		if (a == 4 && b == 8) CollectFigures<4, 8>(n, threads, *collection);
+		if (a == 4 && b == 4) CollectFigures<4, 4>(n, threads, *collection);
+		if (a == 8 && b == 0) CollectFigures<8, 0>(n, threads, *collection);
+		if (a == 8 && b == 8) CollectFigures<8, 8>(n, threads, *collection);
+		if (a == 8 && b == 4) CollectFigures<8, 4>(n, threads, *collection);
+		array->collection = collection.release();
+	}
+	catch (std::bad_alloc const&) {
+		bNoMemory = true;
+	}
+	Py_END_ALLOW_THREADS
+	if (bNoMemory) {
+		Py_DECREF(array);
+		return PyErr_NoMemory();
+	}
+
+	array->shape[0] = (Py_ssize_t)array->collection->size;
+	array->shape[1] = (Py_ssize_t)sizeof(Record);
+	array->strides[0] = (Py_ssize_t)sizeof(Record);
+	array->strides[1] = 1;
+	return (PyObject*)array;
+}
+
+static PyMethodDef Module_methods[] = {
+	{ "count", (PyCFunction)(void(*)(void))Module_count, METH_VARARGS | METH_KEYWORDS,
+		"count(n, a, b, threads=0)\n--\n\nNumbers of figures of size 1 to n, for connectivity (a, b)." },
+	{ "figures", (PyCFunction)(void(*)(void))Module_figures, METH_VARARGS | METH_KEYWORDS,
+		"figures(n, a, b, threads=0)\n--\n\nAll figures of size n, for connectivity (a, b), as a FigureArray." },
+	{},
+};
+
+static PyModuleDef Module_definition = {};
+
+PyMODINIT_FUNC PyInit_figuregen()
+{
+	FigureArray_sequenceMethods.sq_length = (lenfunc)FigureArray_length;
+
+	Py_SET_REFCNT((PyObject*)&FigureArrayType, 1);
+	FigureArrayType.tp_name = "figuregen.FigureArray";
+	FigureArrayType.tp_doc = "Read-only array of FigureRecord, with the buffer protocol, of shape (figures, record_size).";
+	FigureArrayType.tp_basicsize = sizeof(FigureArrayObject);
+	FigureArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+	FigureArrayType.tp_dealloc = (destructor)FigureArray_dealloc;
+	FigureArrayType.tp_as_buffer = &FigureArray_bufferProcs;
+	FigureArrayType.tp_as_sequence = &FigureArray_sequenceMethods;
+	FigureArrayType.tp_getset = FigureArray_getset;
+	if (PyType_Ready(&FigureArrayType) < 0)
+		return nullptr;
+
+	Module_definition.m_base = PyModuleDef_HEAD_INIT;
+	Module_definition.m_name = "figuregen";
+	Module_definition.m_doc = "Enumeration of polyominos with FigureGenerator.";
+	Module_definition.m_size = -1;
+	Module_definition.m_methods = Module_methods;
+	PyObject* module = PyModule_Create(&Module_definition);
+	if (module == nullptr)
+		return nullptr;
+	Py_INCREF(&FigureArrayType);
+	if (PyModule_AddObject(module, "FigureArray", (PyObject*)&FigureArrayType) < 0
+		|| PyModule_AddIntConstant(module, "NMAX", NMAX) < 0)
+	{
+		Py_DECREF(&FigureArrayType);
+		Py_DECREF(module);
+		return nullptr;
+	}
+	return module;
+}